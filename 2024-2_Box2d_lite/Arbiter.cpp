@@ -13,11 +13,39 @@
 #include "Body.h"
 #include "World.h"
 
-#include "glut.h"
+bool BodyLess(const Body* b1, const Body* b2)
+{
+	if (b1->id != b2->id)
+		return b1->id < b2->id;
+	return b1 < b2;
+}
+
+bool ShouldCollide(const Body* b1, const Body* b2)
+{
+	if (b1->groupIndex == b2->groupIndex && b1->groupIndex != 0)
+		return b1->groupIndex > 0;
+
+	return (b1->categoryBits & b2->maskBits) != 0 && (b2->categoryBits & b1->maskBits) != 0;
+}
 
-Arbiter::Arbiter(Body* b1, Body* b2)
+ArbiterKey::ArbiterKey(Body* b1, Body* b2)
 {
-	if (b1 < b2)
+	if (BodyLess(b1, b2))
+	{
+		body1 = b1; body2 = b2;
+	}
+	else
+	{
+		body1 = b2; body2 = b1;
+	}
+
+	id1 = body1->id;
+	id2 = body2->id;
+}
+
+Arbiter::Arbiter(Body* b1, Body* b2, real margin)
+{
+	if (BodyLess(b1, b2))
 	{
 		body1 = b1;
 		body2 = b2;
@@ -28,22 +56,51 @@ Arbiter::Arbiter(Body* b1, Body* b2)
 		body2 = b1;
 	}
 
-	numContacts = Collide(contacts, body1, body2);
+	friction = Sqrt(body1->friction * body2->friction);
+	sensor = body1->isSensor || body2->isSensor;
 
-	friction = sqrtf(body1->friction * body2->friction);
+	// Sensors report true overlap only.
+	numContacts = Collide(contacts, body1, body2, sensor ? 0.0f : margin);
+}
 
-	glPointSize(4.0f);
-	glColor3f(1.0f, 0.0f, 0.0f);
-	glBegin(GL_POINTS);
-	for (int i = 0; i < numContacts; ++i)
-	{
-		glVertex2f(contacts[i].position.x, contacts[i].position.y);
-	}
-	glEnd();
-	glPointSize(1.0f);
+static void LinkEdge(ContactEdge* edge, Body* body)
+{
+	edge->prev = NULL;
+	edge->next = body->contactList;
+	if (body->contactList)
+		body->contactList->prev = edge;
+	body->contactList = edge;
+}
+
+static void UnlinkEdge(ContactEdge* edge, Body* body)
+{
+	if (edge->prev)
+		edge->prev->next = edge->next;
+	else
+		body->contactList = edge->next;
+
+	if (edge->next)
+		edge->next->prev = edge->prev;
+}
+
+void Arbiter::Link()
+{
+	node1.other = body2;
+	node1.arbiter = this;
+	LinkEdge(&node1, body1);
+
+	node2.other = body1;
+	node2.arbiter = this;
+	LinkEdge(&node2, body2);
 }
 
-void Arbiter::Update(Contact* newContacts, int numNewContacts)
+void Arbiter::Unlink()
+{
+	UnlinkEdge(&node1, body1);
+	UnlinkEdge(&node2, body2);
+}
+
+void Arbiter::Update(Contact* newContacts, int numNewContacts, const SolverConfig& config)
 {
 	Contact mergedContacts[2];
 
@@ -66,7 +123,7 @@ void Arbiter::Update(Contact* newContacts, int numNewContacts)
 			Contact* c = mergedContacts + i;
 			Contact* cOld = contacts + k;
 			*c = *cNew;
-			if (World::warmStarting)
+			if (config.warmStarting)
 			{
 				c->Pn = cOld->Pn;
 				c->Pt = cOld->Pt;
@@ -92,10 +149,9 @@ void Arbiter::Update(Contact* newContacts, int numNewContacts)
 }
 
 
-void Arbiter::PreStep(float inv_dt)
+void Arbiter::PreStep(real inv_dt, const SolverConfig& config)
 {
-	const float k_allowedPenetration = 0.01f;
-	float k_biasFactor = World::positionCorrection ? 0.2f : 0.0f;
+	real biasFactor = config.positionCorrection ? config.biasFactor : 0.0f;
 
 	for (int i = 0; i < numContacts; ++i)
 	{
@@ -105,22 +161,31 @@ void Arbiter::PreStep(float inv_dt)
 		Vec2 r2 = c->position - body2->position;
 
 		// Precompute normal mass, tangent mass, and bias.
-		float rn1 = Dot(r1, c->normal);
-		float rn2 = Dot(r2, c->normal);
-		float kNormal = body1->invMass + body2->invMass;
+		real rn1 = Dot(r1, c->normal);
+		real rn2 = Dot(r2, c->normal);
+		real kNormal = body1->invMass + body2->invMass;
 		kNormal += body1->invI * (Dot(r1, r1) - rn1 * rn1) + body2->invI * (Dot(r2, r2) - rn2 * rn2);
-		c->massNormal = 1.0f / kNormal;
+		c->massNormal = kNormal > 0.0f ? 1.0f / kNormal : 0.0f;
 
 		Vec2 tangent = Cross(c->normal, 1.0f);
-		float rt1 = Dot(r1, tangent);
-		float rt2 = Dot(r2, tangent);
-		float kTangent = body1->invMass + body2->invMass;
+		real rt1 = Dot(r1, tangent);
+		real rt2 = Dot(r2, tangent);
+		real kTangent = body1->invMass + body2->invMass;
 		kTangent += body1->invI * (Dot(r1, r1) - rt1 * rt1) + body2->invI * (Dot(r2, r2) - rt2 * rt2);
-		c->massTangent = 1.0f /  kTangent;
+		c->massTangent = kTangent > 0.0f ? 1.0f / kTangent : 0.0f;
 
-		c->bias = -k_biasFactor * inv_dt * Min(0.0f, c->separation + k_allowedPenetration);
+		if (c->separation > 0.0f)
+		{
+			// Speculative contact: allow closing the gap within this step,
+			// push only against the excess approach.
+			c->bias = -inv_dt * c->separation;
+		}
+		else
+		{
+			c->bias = -biasFactor * inv_dt * Min(0.0f, c->separation + config.allowedPenetration);
+		}
 
-		if (World::accumulateImpulses)
+		if (config.accumulateImpulses)
 		{
 			// Apply normal + friction impulse
 			Vec2 P = c->Pn * c->normal + c->Pt * tangent;
@@ -134,7 +199,7 @@ void Arbiter::PreStep(float inv_dt)
 	}
 }
 
-void Arbiter::ApplyImpulse()
+void Arbiter::ApplyImpulse(const SolverConfig& config)
 {
 	Body* b1 = body1;
 	Body* b2 = body2;
@@ -149,14 +214,14 @@ void Arbiter::ApplyImpulse()
 		Vec2 dv = b2->velocity + Cross(b2->angularVelocity, c->r2) - b1->velocity - Cross(b1->angularVelocity, c->r1);
 
 		// Compute normal impulse
-		float vn = Dot(dv, c->normal);
+		real vn = Dot(dv, c->normal);
 
-		float dPn = c->massNormal * (-vn + c->bias);
+		real dPn = c->massNormal * (-vn + c->bias);
 
-		if (World::accumulateImpulses)
+		if (config.accumulateImpulses)
 		{
 			// Clamp the accumulated impulse
-			float Pn0 = c->Pn;
+			real Pn0 = c->Pn;
 			c->Pn = Max(Pn0 + dPn, 0.0f);
 			dPn = c->Pn - Pn0;
 		}
@@ -178,22 +243,22 @@ void Arbiter::ApplyImpulse()
 		dv = b2->velocity + Cross(b2->angularVelocity, c->r2) - b1->velocity - Cross(b1->angularVelocity, c->r1);
 
 		Vec2 tangent = Cross(c->normal, 1.0f);
-		float vt = Dot(dv, tangent);
-		float dPt = c->massTangent * (-vt);
+		real vt = Dot(dv, tangent);
+		real dPt = c->massTangent * (-vt);
 
-		if (World::accumulateImpulses)
+		if (config.accumulateImpulses)
 		{
 			// Compute friction impulse
-			float maxPt = friction * c->Pn;
+			real maxPt = friction * c->Pn;
 
 			// Clamp friction
-			float oldTangentImpulse = c->Pt;
+			real oldTangentImpulse = c->Pt;
 			c->Pt = Clamp(oldTangentImpulse + dPt, -maxPt, maxPt);
 			dPt = c->Pt - oldTangentImpulse;
 		}
 		else
 		{
-			float maxPt = friction * dPn;
+			real maxPt = friction * dPn;
 			dPt = Clamp(dPt, -maxPt, maxPt);
 		}
 
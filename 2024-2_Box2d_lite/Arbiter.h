@@ -15,6 +15,13 @@
 #include "MathUtils.h"
 
 struct Body;
+struct SolverConfig;
+
+// Orders bodies by World id, falling back to address for bodies outside a world.
+bool BodyLess(const Body* b1, const Body* b2);
+
+// Category/mask/group test applied before any narrow-phase work.
+bool ShouldCollide(const Body* b1, const Body* b2);
 
 union FeaturePair
 {
@@ -30,48 +37,58 @@ union FeaturePair
 
 struct Contact
 {
-	Contact() : Pn(0.0f), Pt(0.0f), Pnb(0.0f) {}
+	Contact() : Pn(0.0f), Pt(0.0f), Pnb(0.0f) { feature.value = 0; }
 
 	Vec2 position;
 	Vec2 normal;
 	Vec2 r1, r2;
-	float separation;
-	float Pn;	// accumulated normal impulse
-	float Pt;	// accumulated tangent impulse
-	float Pnb;	// accumulated normal impulse for position bias
-	float massNormal, massTangent;
-	float bias;
+	real separation;
+	real Pn;	// accumulated normal impulse
+	real Pt;	// accumulated tangent impulse
+	real Pnb;	// accumulated normal impulse for position bias
+	real massNormal, massTangent;
+	real bias;
 	FeaturePair feature;
 };
 
+struct Arbiter;
+
+// Node in a body's list of arbiters; each arbiter owns one per body.
+struct ContactEdge
+{
+	Body* other;
+	Arbiter* arbiter;
+	ContactEdge* prev;
+	ContactEdge* next;
+};
+
 struct ArbiterKey
 {
-	ArbiterKey(Body* b1, Body* b2)
-	{
-		if (b1 < b2)
-		{
-			body1 = b1; body2 = b2;
-		}
-		else
-		{
-			body1 = b2; body2 = b1;
-		}
-	}
+	ArbiterKey(Body* b1, Body* b2);
 
 	Body* body1;
 	Body* body2;
+	int id1, id2;
 };
 
 struct Arbiter
 {
 	enum {MAX_POINTS = 2};
 
-	Arbiter(Body* b1, Body* b2);
+	Arbiter() : numContacts(0), body1(0), body2(0), friction(0.0f), sensor(false) {}
+	// Contacts up to margin apart are kept as speculative contacts.
+	Arbiter(Body* b1, Body* b2, real margin = 0.0f);
+
+	void Update(Contact* contacts, int numContacts, const SolverConfig& config);
 
-	void Update(Contact* contacts, int numContacts);
+	// Adds or removes the arbiter in both bodies' contact lists. Only
+	// arbiters at their final address, i.e. inside World::arbiters, are
+	// linked.
+	void Link();
+	void Unlink();
 
-	void PreStep(float inv_dt);
-	void ApplyImpulse();
+	void PreStep(real inv_dt, const SolverConfig& config);
+	void ApplyImpulse(const SolverConfig& config);
 
 	Contact contacts[MAX_POINTS];
 	int numContacts;
@@ -80,21 +97,32 @@ struct Arbiter
 	Body* body2;
 
 	// Combined friction
-	float friction;
+	real friction;
+
+	// Either body is a sensor: contacts are tracked but never solved.
+	bool sensor;
+
+	ContactEdge node1;	// in body1->contactList
+	ContactEdge node2;	// in body2->contactList
 };
 
 // This is used by std::set
 inline bool operator < (const ArbiterKey& a1, const ArbiterKey& a2)
 {
-	if (a1.body1 < a2.body1)
-		return true;
+	if (a1.id1 != a2.id1)
+		return a1.id1 < a2.id1;
+
+	if (a1.id2 != a2.id2)
+		return a1.id2 < a2.id2;
 
-	if (a1.body1 == a2.body1 && a1.body2 < a2.body2)
-		return true;
+	if (a1.body1 != a2.body1)
+		return a1.body1 < a2.body1;
 
-	return false;
+	return a1.body2 < a2.body2;
 }
 
-int Collide(Contact* contacts, Body* body1, Body* body2);
+// Reports contact points separated by at most margin; positive
+// separations are speculative.
+int Collide(Contact* contacts, Body* body1, Body* body2, real margin);
 
 #endif
@@ -0,0 +1,98 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+#include "BlockAllocator.h"
+
+#include <stdlib.h>
+
+// Chunk header is padded so blocks keep 16 byte alignment.
+static const int k_chunkHeader = 16;
+
+BlockAllocator::BlockAllocator() : chunks(NULL), numChunks(0)
+{
+	for (int i = 0; i < k_numSizeClasses; ++i)
+		freeLists[i] = NULL;
+}
+
+BlockAllocator::~BlockAllocator()
+{
+	Clear();
+}
+
+void BlockAllocator::Clear()
+{
+	while (chunks)
+	{
+		Chunk* next = chunks->next;
+		free(chunks);
+		chunks = next;
+	}
+	numChunks = 0;
+
+	for (int i = 0; i < k_numSizeClasses; ++i)
+		freeLists[i] = NULL;
+}
+
+void* BlockAllocator::Allocate(int size)
+{
+	if (size <= 0)
+		return NULL;
+
+	if (size > k_maxBlockSize)
+		return malloc(size);
+
+	int index = (size - 1) / k_blockGranularity;
+	if (freeLists[index])
+	{
+		Block* block = freeLists[index];
+		freeLists[index] = block->next;
+		return block;
+	}
+
+	// Carve a new chunk into blocks of this class.
+	Chunk* chunk = (Chunk*)malloc(k_chunkHeader + k_chunkSize);
+	if (chunk == NULL)
+		throw std::bad_alloc();
+	chunk->next = chunks;
+	chunks = chunk;
+	++numChunks;
+
+	int blockSize = (index + 1) * k_blockGranularity;
+	int blockCount = k_chunkSize / blockSize;
+	char* base = (char*)chunk + k_chunkHeader;
+	for (int i = 0; i < blockCount - 1; ++i)
+	{
+		Block* block = (Block*)(base + i * blockSize);
+		block->next = (Block*)(base + (i + 1) * blockSize);
+	}
+	Block* last = (Block*)(base + (blockCount - 1) * blockSize);
+	last->next = NULL;
+
+	freeLists[index] = ((Block*)base)->next;
+	return base;
+}
+
+void BlockAllocator::Free(void* p, int size)
+{
+	if (p == NULL || size <= 0)
+		return;
+
+	if (size > k_maxBlockSize)
+	{
+		free(p);
+		return;
+	}
+
+	int index = (size - 1) / k_blockGranularity;
+	Block* block = (Block*)p;
+	block->next = freeLists[index];
+	freeLists[index] = block;
+}
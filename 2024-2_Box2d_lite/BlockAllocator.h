@@ -0,0 +1,98 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+#ifndef BLOCKALLOCATOR_H
+#define BLOCKALLOCATOR_H
+
+#include <stddef.h>
+#include <new>
+
+// Small object allocator. Blocks are rounded up to a size class and carved
+// from large chunks; freed blocks go on a per-class free list, so objects
+// created and destroyed every step reuse memory without touching the heap.
+struct BlockAllocator
+{
+	enum
+	{
+		k_chunkSize = 16 * 1024,
+		k_maxBlockSize = 512,
+		k_blockGranularity = 16,
+		k_numSizeClasses = k_maxBlockSize / k_blockGranularity
+	};
+
+	BlockAllocator();
+	~BlockAllocator();
+
+	// Sizes above k_maxBlockSize go straight to malloc.
+	void* Allocate(int size);
+	void Free(void* p, int size);
+
+	// Releases every chunk. All blocks must have been freed.
+	void Clear();
+
+	int GetChunkCount() const { return numChunks; }
+
+private:
+	BlockAllocator(const BlockAllocator&);
+	void operator = (const BlockAllocator&);
+
+	struct Block
+	{
+		Block* next;
+	};
+
+	struct Chunk
+	{
+		Chunk* next;
+	};
+
+	Block* freeLists[k_numSizeClasses];
+	Chunk* chunks;
+	int numChunks;
+};
+
+// Standard allocator adapter so containers can draw their nodes from a
+// BlockAllocator, e.g. the std::map holding World::arbiters.
+template<typename T>
+struct PoolAllocator
+{
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	template<typename U> struct rebind { typedef PoolAllocator<U> other; };
+
+	explicit PoolAllocator(BlockAllocator* blocks) : blocks(blocks) {}
+	template<typename U> PoolAllocator(const PoolAllocator<U>& other) : blocks(other.blocks) {}
+
+	T* allocate(size_t n)
+	{
+		return (T*)blocks->Allocate((int)(n * sizeof(T)));
+	}
+
+	void deallocate(T* p, size_t n)
+	{
+		blocks->Free(p, (int)(n * sizeof(T)));
+	}
+
+	size_t max_size() const { return ((size_t)-1) / sizeof(T); }
+
+	template<typename U> bool operator == (const PoolAllocator<U>& other) const { return blocks == other.blocks; }
+	template<typename U> bool operator != (const PoolAllocator<U>& other) const { return blocks != other.blocks; }
+
+	BlockAllocator* blocks;
+};
+
+#endif
@@ -19,11 +19,25 @@ Body::Body()
 	invI = 0.0f;
 	shape = BOX;
 	radius = 0;
+	type = STATIC_BODY;
+	targetPosition.Set(0.0f, 0.0f);
+	targetRotation = 0.0f;
 
 	canDrag = true;
+	isSensor = false;
+	isBullet = false;
+	categoryBits = 0x0001;
+	maskBits = 0xFFFF;
+	groupIndex = 0;
+	regionMask = 0;
+	id = 0;
+	index = -1;
+	solverIterations = 0;
+	contactList = NULL;
+	jointList = NULL;
 }
 
-void Body::BoxSet(const Vec2& w, float m)
+void Body::BoxSet(const Vec2& w, real m)
 {
 	shape = BOX;
 	position.Set(0.0f, 0.0f);
@@ -39,12 +53,14 @@ void Body::BoxSet(const Vec2& w, float m)
 
 	if (mass < FLT_MAX)
 	{
+		type = DYNAMIC_BODY;
 		invMass = 1.0f / mass;
 		I = mass * (width.x * width.x + width.y * width.y) / 12.0f;
 		invI = 1.0f / I;
 	}
 	else
 	{
+		type = STATIC_BODY;
 		invMass = 0.0f;
 		I = FLT_MAX;
 		invI = 0.0f;
@@ -52,7 +68,7 @@ void Body::BoxSet(const Vec2& w, float m)
 
 }
 
-void Body::CircleSet(const Vec2& w, float m)
+void Body::CircleSet(const Vec2& w, real m)
 {
 	shape = CIRCLE;
 	position.Set(0.0f, 0.0f);
@@ -69,18 +85,20 @@ void Body::CircleSet(const Vec2& w, float m)
 
 	if (mass < FLT_MAX)
 	{
+		type = DYNAMIC_BODY;
 		invMass = 1.0f / mass;
 		I = mass * (radius * radius) / 2;
 		invI = 1.0f / I;
 	}
 	else
 	{
+		type = STATIC_BODY;
 		invMass = 0.0f;
 		I = FLT_MAX;
 		invI = 0.0f;
 	}
 }
-void Body::TriangleSet(const Vec2& w, float m)
+void Body::TriangleSet(const Vec2& w, real m)
 {
 	shape = TRIANGLE;
 	position.Set(0.0f, 0.0f);
@@ -97,12 +115,14 @@ void Body::TriangleSet(const Vec2& w, float m)
 
 	if (mass < FLT_MAX)
 	{
+		type = DYNAMIC_BODY;
 		invMass = 1.0f / mass;
 		I = mass * (width.x * width.x + width.y * width.y) / 18;
 		invI = 1.0f / I;
 	}
 	else
 	{
+		type = STATIC_BODY;
 		invMass = 0.0f;
 		I = FLT_MAX;
 		invI = 0.0f;
@@ -110,3 +130,83 @@ void Body::TriangleSet(const Vec2& w, float m)
 
 }
 
+void Body::ComputeAABB(AABB& aabb) const
+{
+	Vec2 extents;
+	if (shape == CIRCLE)
+	{
+		extents.Set(radius, radius);
+	}
+	else
+	{
+		// Box-triangle and triangle-triangle collision use unrotated
+		// vertices, so cover both the rotated and the unrotated outline.
+		Vec2 h = 0.5f * width;
+		Mat22 R(rotation);
+		Vec2 r = Abs(R) * h;
+		extents.Set(Max(r.x, h.x), Max(r.y, h.y));
+	}
+
+	aabb.lowerBound = position - extents;
+	aabb.upperBound = position + extents;
+}
+
+bool Body::TestPoint(const Vec2& p) const
+{
+	Vec2 d = p - position;
+
+	if (shape == CIRCLE)
+		return Dot(d, d) <= radius * radius;
+
+	Mat22 RotT = Mat22(rotation).Transpose();
+	Vec2 local = RotT * d;
+	Vec2 h = 0.5f * width;
+
+	if (shape == BOX)
+		return Abs(local.x) <= h.x && Abs(local.y) <= h.y;
+
+	// Triangle with vertices (-h.x, -h.y), (h.x, -h.y), (0, h.y).
+	Vec2 v1(-h.x, -h.y), v2(h.x, -h.y), v3(0.0f, h.y);
+	real c1 = Cross(v2 - v1, local - v1);
+	real c2 = Cross(v3 - v2, local - v2);
+	real c3 = Cross(v1 - v3, local - v3);
+	return c1 >= 0.0f && c2 >= 0.0f && c3 >= 0.0f;
+}
+
+void Body::SetKinematic(bool kinematic)
+{
+	if (kinematic)
+	{
+		type = KINEMATIC_BODY;
+		invMass = 0.0f;
+		invI = 0.0f;
+		velocity.Set(0.0f, 0.0f);
+		angularVelocity = 0.0f;
+		targetPosition = position;
+		targetRotation = rotation;
+	}
+	else if (mass < FLT_MAX)
+	{
+		type = DYNAMIC_BODY;
+		invMass = 1.0f / mass;
+		invI = 1.0f / I;
+	}
+	else
+	{
+		type = STATIC_BODY;
+		velocity.Set(0.0f, 0.0f);
+		angularVelocity = 0.0f;
+	}
+}
+
+void Body::SetTarget(const Vec2& position, real rotation)
+{
+	targetPosition = position;
+	targetRotation = rotation;
+}
+
+real Body::MotionBound(real dt) const
+{
+	real extent = shape == CIRCLE ? radius : (0.5f * width).Length();
+	return dt * (velocity.Length() + Abs(angularVelocity) * extent);
+}
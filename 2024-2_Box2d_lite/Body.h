@@ -14,42 +14,106 @@
 
 #include "MathUtils.h"
 
+struct ContactEdge;
+struct JointEdge;
+
 enum EShape { //  
 	BOX,CIRCLE,TRIANGLE
 };
 
+enum EBodyType {
+	STATIC_BODY,	// infinite mass, never moves
+	DYNAMIC_BODY,
+	KINEMATIC_BODY	// infinite mass, moved toward a target pose
+};
+
 struct Body
 {
 
 	Body();
-	void BoxSet(const Vec2& w, float m);
-	void CircleSet(const Vec2& w, float m);
-	void TriangleSet(const Vec2& w, float m);
+	void BoxSet(const Vec2& w, real m);
+	void CircleSet(const Vec2& w, real m);
+	void TriangleSet(const Vec2& w, real m);
 
 	void AddForce(const Vec2& f)
 	{
 		force += f;
 	}
 
+	// Kinematic bodies keep their mass for when they turn dynamic again,
+	// but the solver treats them as immovable. Each Step sets their
+	// velocity so they reach the target pose at the end of the step.
+	void SetKinematic(bool kinematic);
+	void SetTarget(const Vec2& position, real rotation);
+
+	// Bounds used by the broad-phase. Conservative for every shape pair
+	// handled by Collide.
+	void ComputeAABB(AABB& aabb) const;
+
+	// Exact point containment honoring rotation.
+	bool TestPoint(const Vec2& p) const;
+
+	// Upper bound on how far any point of the body travels in dt at the
+	// current velocity.
+	real MotionBound(real dt) const;
+
 	Vec2 position;
-	float rotation;
+	real rotation;
 
 	Vec2 velocity;
-	float angularVelocity;
+	real angularVelocity;
 
 	Vec2 force;
-	float torque;
+	real torque;
 
 	Vec2 width;
 
-	float friction;
-	float mass, invMass;
-	float I, invI;
+	real friction;
+	real mass, invMass;
+	real I, invI;
 
-	float radius;
+	real radius;
 	EShape shape;
 
+	EBodyType type;
+	Vec2 targetPosition;
+	real targetRotation;
+
 	bool canDrag;
+
+	// Sensors report contacts but never receive or apply impulses.
+	bool isSensor;
+
+	// Bullets are swept against other bodies during Step so small, fast
+	// bodies cannot pass through thin ones between two steps.
+	bool isBullet;
+
+	// Collision filtering. Bodies sharing a non-zero group always collide
+	// (positive) or never collide (negative); otherwise each category must
+	// be accepted by the other body's mask.
+	unsigned short categoryBits;
+	unsigned short maskBits;
+	short groupIndex;
+
+	// Bit i is set while the body center is inside World region i.
+	unsigned int regionMask;
+
+	// Creation order within the World, kept when other bodies are removed.
+	// Contact pairs are ordered by id rather than by address so the solver
+	// order does not depend on allocation.
+	int id;
+
+	// Position in World::bodies; changes when another body is removed.
+	int index;
+
+	// Iterations the body's island starts from in the next adaptive Step;
+	// 0 until the body has been in a solved island.
+	int solverIterations;
+
+	// Arbiters and joints attached to this body, maintained by World.
+	// Walking them answers adjacency questions in O(degree).
+	ContactEdge* contactList;
+	JointEdge* jointList;
 };
 
 #endif
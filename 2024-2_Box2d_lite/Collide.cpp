@@ -12,6 +12,7 @@
 #include "Arbiter.h"
 #include "Body.h"
 #include <utility>
+#include <algorithm>
 
 // Box vertex and edge numbering:
 //
@@ -61,13 +62,13 @@ void Flip(FeaturePair& fp)
 }
 
 int ClipSegmentToLine(ClipVertex vOut[2], ClipVertex vIn[2],
-	const Vec2& normal, float offset, char clipEdge)
+	const Vec2& normal, real offset, char clipEdge)
 {
 	int numOut = 0;
 
 
-	float distance0 = Dot(normal, vIn[0].v) - offset;
-	float distance1 = Dot(normal, vIn[1].v) - offset;
+	real distance0 = Dot(normal, vIn[0].v) - offset;
+	real distance1 = Dot(normal, vIn[1].v) - offset;
 
 	// If the points are behind the plane
 	if (distance0 <= 0.0f) vOut[numOut++] = vIn[0];
@@ -77,7 +78,7 @@ int ClipSegmentToLine(ClipVertex vOut[2], ClipVertex vIn[2],
 	if (distance0 * distance1 < 0.0f)
 	{
 		// Find intersection point of edge and plane
-		float interp = distance0 / (distance0 - distance1);
+		real interp = distance0 / (distance0 - distance1);
 		vOut[numOut].v = vIn[0].v + interp * (vIn[1].v - vIn[0].v);
 		if (distance0 > 0.0f)
 		{
@@ -157,17 +158,18 @@ static void ComputeIncidentEdge(ClipVertex c[2], const Vec2& h, const Vec2& pos,
 	c[1].v = pos + Rot * c[1].v;
 }
 
-int BoxToCircle(Body*& bodyB, Body*& bodyA, Contact* contacts)
+// Contact normals are unit length and point from bodyA to bodyB.
+int BoxToCircle(Body* bodyA, Body* bodyB, Contact* contacts, real margin)
 {
-	if (bodyB->shape == 1)
-		std::swap(bodyA, bodyB);
+	Body* circle = bodyA->shape == CIRCLE ? bodyA : bodyB;
+	Body* box = circle == bodyA ? bodyB : bodyA;
 
-	Vec2 circlePos = bodyA->position;
-	float radius = bodyA->radius;
+	Vec2 circlePos = circle->position;
+	real radius = circle->radius;
 
-	Vec2 boxPos = bodyB->position;
-	Vec2 h = 0.5f * bodyB->width;
-	Mat22 Rot(bodyB->rotation);
+	Vec2 boxPos = box->position;
+	Vec2 h = 0.5f * box->width;
+	Mat22 Rot(box->rotation);
 	Mat22 RotT = Rot.Transpose();
 
 	Vec2 localCirclePos = RotT * (circlePos - boxPos);
@@ -177,25 +179,24 @@ int BoxToCircle(Body*& bodyB, Body*& bodyA, Contact* contacts)
 	closestPoint.y = std::max(-h.y, std::min(closestPoint.y, h.y));
 
 	Vec2 d = localCirclePos - closestPoint;
-	float distSquared = Dot(d, d);
+	real distSquared = Dot(d, d);
 
 
-	if (distSquared <= radius * radius)
+	if (distSquared <= (radius + margin) * (radius + margin))
 	{
-		float dist = sqrt(distSquared);
+		real dist = Sqrt(distSquared);
 
 		Vec2 normal = dist > 0.0f ? (Rot * d) / dist : Vec2(1.0f, 0.0f);
-		normal *= radius;
 
-		contacts[0].position = circlePos - normal;
-		contacts[0].normal = normal;
+		contacts[0].position = circlePos - radius * normal;
+		contacts[0].normal = circle == bodyA ? -normal : normal;
 		contacts[0].separation = dist - radius;
 		return 1;
 	}
 	return 0;
 }
 
-int BoxToBox(Body* bodyA, Body* bodyB, Contact* contacts)
+int BoxToBox(Body* bodyA, Body* bodyB, Contact* contacts, real margin)
 {
 	// Setup
 	Vec2 hA = 0.5f * bodyA->width;
@@ -219,17 +220,17 @@ int BoxToBox(Body* bodyA, Body* bodyB, Contact* contacts)
 
 	// Box A faces
 	Vec2 faceA = Abs(dA) - hA - absC * hB;
-	if (faceA.x > 0.0f || faceA.y > 0.0f)
+	if (faceA.x > margin || faceA.y > margin)
 		return 0;
 
 	// Box B faces
 	Vec2 faceB = Abs(dB) - absCT * hA - hB;
-	if (faceB.x > 0.0f || faceB.y > 0.0f)
+	if (faceB.x > margin || faceB.y > margin)
 		return 0;
 
 	// Find best axis
 	Axis axis;
-	float separation;
+	real separation;
 	Vec2 normal;
 
 	// Box A faces
@@ -237,8 +238,8 @@ int BoxToBox(Body* bodyA, Body* bodyB, Contact* contacts)
 	separation = faceA.x;
 	normal = dA.x > 0.0f ? RotA.col1 : -RotA.col1;
 
-	const float relativeTol = 0.95f;
-	const float absoluteTol = 0.01f;
+	const real relativeTol = 0.95f;
+	const real absoluteTol = 0.01f;
 
 	if (faceA.y > relativeTol * separation + absoluteTol * hA.y)
 	{
@@ -265,7 +266,7 @@ int BoxToBox(Body* bodyA, Body* bodyB, Contact* contacts)
 	// Setup clipping plane data based on the separating axis
 	Vec2 frontNormal, sideNormal;
 	ClipVertex incidentEdge[2];
-	float front, negSide, posSide;
+	real front, negSide, posSide;
 	char negEdge, posEdge;
 
 	// Compute the clipping lines and the line segment to be clipped.
@@ -276,7 +277,7 @@ int BoxToBox(Body* bodyA, Body* bodyB, Contact* contacts)
 		frontNormal = normal;
 		front = Dot(posA, frontNormal) + hA.x;
 		sideNormal = RotA.col2;
-		float side = Dot(posA, sideNormal);
+		real side = Dot(posA, sideNormal);
 		negSide = -side + hA.y;
 		posSide = side + hA.y;
 		negEdge = EDGE3;
@@ -290,7 +291,7 @@ int BoxToBox(Body* bodyA, Body* bodyB, Contact* contacts)
 		frontNormal = normal;
 		front = Dot(posA, frontNormal) + hA.y;
 		sideNormal = RotA.col1;
-		float side = Dot(posA, sideNormal);
+		real side = Dot(posA, sideNormal);
 		negSide = -side + hA.x;
 		posSide = side + hA.x;
 		negEdge = EDGE2;
@@ -304,7 +305,7 @@ int BoxToBox(Body* bodyA, Body* bodyB, Contact* contacts)
 		frontNormal = -normal;
 		front = Dot(posB, frontNormal) + hB.x;
 		sideNormal = RotB.col2;
-		float side = Dot(posB, sideNormal);
+		real side = Dot(posB, sideNormal);
 		negSide = -side + hB.y;
 		posSide = side + hB.y;
 		negEdge = EDGE3;
@@ -318,7 +319,7 @@ int BoxToBox(Body* bodyA, Body* bodyB, Contact* contacts)
 		frontNormal = -normal;
 		front = Dot(posB, frontNormal) + hB.y;
 		sideNormal = RotB.col1;
-		float side = Dot(posB, sideNormal);
+		real side = Dot(posB, sideNormal);
 		negSide = -side + hB.x;
 		posSide = side + hB.x;
 		negEdge = EDGE2;
@@ -352,9 +353,9 @@ int BoxToBox(Body* bodyA, Body* bodyB, Contact* contacts)
 	int numContacts = 0;
 	for (int i = 0; i < 2; ++i)
 	{
-		float separation = Dot(frontNormal, clipPoints2[i].v) - front;
+		real separation = Dot(frontNormal, clipPoints2[i].v) - front;
 
-		if (separation <= 0)
+		if (separation <= margin)
 		{
 			contacts[numContacts].separation = separation;
 			contacts[numContacts].normal = normal;
@@ -369,7 +370,7 @@ int BoxToBox(Body* bodyA, Body* bodyB, Contact* contacts)
 	return numContacts;
 }
 
-int TriangleToTriangle(Body* bodyA, Body* bodyB, Contact* contacts)
+int TriangleToTriangle(Body* bodyA, Body* bodyB, Contact* contacts, real margin)
 {
 	
 	Vec2 vertsA[3] = {
@@ -394,35 +395,33 @@ int TriangleToTriangle(Body* bodyA, Body* bodyB, Contact* contacts)
 	    OrthogonalVec(vertsB[0] - vertsB[2]).Normalize()
 	};
 
-	float minOverlap = FLT_MAX;
+	real minOverlap = FLT_MAX;
 	Vec2 smallestAxis;
 
-	const float epsilon = 1e-6f;
+	const real epsilon = 1e-6f;
 	for (int i = 0; i < 6; ++i)
 	{
-		float minA = FLT_MAX, maxA = -FLT_MAX;
-		float minB = FLT_MAX, maxB = -FLT_MAX;
+		real minA = FLT_MAX, maxA = -FLT_MAX;
+		real minB = FLT_MAX, maxB = -FLT_MAX;
 
-		for (int j = 0; j < 3; ++j)
-		{
-			float proj = Dot(vertsA[j], axes[i]);
-			minA = std::min(minA, proj);
-			maxA = std::max(maxA, proj);
-		}
+		real projA[3], projB[3];
+		DotPoints(projA, vertsA, 3, axes[i]);
+		DotPoints(projB, vertsB, 3, axes[i]);
 
 		for (int j = 0; j < 3; ++j)
 		{
-			float proj = Dot(vertsB[j], axes[i]);
-			minB = std::min(minB, proj);
-			maxB = std::max(maxB, proj);
+			minA = std::min(minA, projA[j]);
+			maxA = std::max(maxA, projA[j]);
+			minB = std::min(minB, projB[j]);
+			maxB = std::max(maxB, projB[j]);
 		}
 
 
-		if (maxA < minB - epsilon || maxB < minA - epsilon)
+		if (maxA < minB - margin - epsilon || maxB < minA - margin - epsilon)
 			return 0; 
 
 
-		float overlap = std::min(maxA, maxB) - std::max(minA, minB);
+		real overlap = std::min(maxA, maxB) - std::max(minA, minB);
 		if (overlap < minOverlap)
 		{
 			minOverlap = overlap;
@@ -441,8 +440,10 @@ int TriangleToTriangle(Body* bodyA, Body* bodyB, Contact* contacts)
 	return 1; 
 }
 
-int BoxToTriangle(Body* bodyA, Body* bodyB, Contact* contacts)
+int BoxToTriangle(Body* bodyA, Body* bodyB, Contact* contacts, real margin)
 {
+	Vec2 dp = bodyB->position - bodyA->position;
+
 	if (bodyA->shape == 0)
 		std::swap(bodyA, bodyB);
 
@@ -468,52 +469,59 @@ int BoxToTriangle(Body* bodyA, Body* bodyB, Contact* contacts)
 	};
 
 
-	float minOverlap = FLT_MAX;
+	real minOverlap = FLT_MAX;
 	Vec2 smallestAxis;
 
 	for (int i = 0; i < 5; ++i)
 	{
-		float minTri = FLT_MAX, maxTri = -FLT_MAX;
-		float minBox = FLT_MAX, maxBox = -FLT_MAX;
+		real minTri = FLT_MAX, maxTri = -FLT_MAX;
+		real minBox = FLT_MAX, maxBox = -FLT_MAX;
+
+		real projTri[3], projBox[4];
+		DotPoints(projTri, triVerts, 3, axes[i]);
+		DotPoints(projBox, boxVerts, 4, axes[i]);
 
-	
 		for (int j = 0; j < 3; ++j)
 		{
-			float proj = Dot(triVerts[j], axes[i]);
-			minTri = std::min(minTri, proj);
-			maxTri = std::max(maxTri, proj);
+			minTri = std::min(minTri, projTri[j]);
+			maxTri = std::max(maxTri, projTri[j]);
 		}
 
 		for (int j = 0; j < 4; ++j)
 		{
-			float proj = Dot(boxVerts[j], axes[i]);
-			minBox = std::min(minBox, proj);
-			maxBox = std::max(maxBox, proj);
+			minBox = std::min(minBox, projBox[j]);
+			maxBox = std::max(maxBox, projBox[j]);
 		}
 
-		if (maxTri < minBox || maxBox < minTri)
+		if (maxTri < minBox - margin || maxBox < minTri - margin)
 			return 0; 
 
-		float overlap = std::min(maxTri, maxBox) - std::max(minTri, minBox);
+		real overlap = std::min(maxTri, maxBox) - std::max(minTri, minBox);
 		if (overlap < minOverlap)
 		{
 			minOverlap = overlap;
 			smallestAxis = axes[i];
 		}
 	}
+	if (Dot(smallestAxis, dp) < 0)
+		smallestAxis = -smallestAxis;
+
 	contacts[0].separation = -minOverlap;
 	contacts[0].normal = smallestAxis;
 	contacts[0].position = (triVerts[0] + triVerts[1] + triVerts[2]) / 3;
 	return 1; 
 }
 
-int CircleToTriangle(Body* bodyA, Body* bodyB, Contact* contacts)
+int CircleToTriangle(Body* bodyA, Body* bodyB, Contact* contacts, real margin)
 {
+	// Normals below point from the triangle to the circle.
+	real flip = bodyA->shape == CIRCLE ? -1.0f : 1.0f;
+
 	if (bodyA->shape == 2)
 		std::swap(bodyA, bodyB);
 
 	Vec2 circlePos = bodyA->position;
-	float radius = bodyA->radius;
+	real radius = bodyA->radius;
 
 	Vec2 triangleVerts[3] = {
 		bodyB->position + Vec2(-bodyB->width.x / 2, -bodyB->width.y / 2),
@@ -530,16 +538,16 @@ int CircleToTriangle(Body* bodyA, Body* bodyB, Contact* contacts)
 	Vec2 toCircle2 = circlePos - triangleVerts[1];
 	Vec2 toCircle3 = circlePos - triangleVerts[2];
 
-	float cross1 = Cross(edge1, toCircle1);
-	float cross2 = Cross(edge2, toCircle2);
-	float cross3 = Cross(edge3, toCircle3);
+	real cross1 = Cross(edge1, toCircle1);
+	real cross2 = Cross(edge2, toCircle2);
+	real cross3 = Cross(edge3, toCircle3);
 
 	bool isInside = (cross1 >= 0 && cross2 >= 0 && cross3 >= 0) || (cross1 <= 0 && cross2 <= 0 && cross3 <= 0);
 
 	if (isInside)
 	{
 		contacts[0].position = circlePos;
-		contacts[0].normal = Vec2(0, 1); 
+		contacts[0].normal = flip * Vec2(0, 1); 
 		contacts[0].separation = -radius;
 		return 1;
 	}
@@ -549,18 +557,18 @@ int CircleToTriangle(Body* bodyA, Body* bodyB, Contact* contacts)
 		Vec2 p1 = triangleVerts[i];
 		Vec2 p2 = triangleVerts[(i + 1) % 3];
 		Vec2 edge = p2 - p1;
-		float t = std::max(0.0f, std::min(1.0f, Dot(circlePos - p1, edge) / Dot(edge, edge)));
+		real t = std::max(real(0.0f), std::min(real(1.0f), Dot(circlePos - p1, edge) / Dot(edge, edge)));
 		Vec2 closestPoint = p1 + t * edge;
 
 		Vec2 d = circlePos - closestPoint;
-		float distSquared = Dot(d, d);
-		if (distSquared <= radius * radius)
+		real distSquared = Dot(d, d);
+		if (distSquared <= (radius + margin) * (radius + margin))
 		{
-			float dist = sqrt(distSquared);
+			real dist = Sqrt(distSquared);
 			Vec2 normal = dist > 0.0f ? d / dist : Vec2(1.0f, 0.0f);
 
 			contacts[0].position = closestPoint;
-			contacts[0].normal = normal;
+			contacts[0].normal = flip * normal;
 			contacts[0].separation = dist - radius;
 			return 1;
 		}
@@ -569,26 +577,24 @@ int CircleToTriangle(Body* bodyA, Body* bodyB, Contact* contacts)
 	return 0;
 }
 
-int CircleToCircle(Body* bodyA, Body* bodyB, Contact* contacts)
+int CircleToCircle(Body* bodyA, Body* bodyB, Contact* contacts, real margin)
 {
 	Vec2 posA = bodyA->position;
 	Vec2 posB = bodyB->position;
-	float radiusA = bodyA->radius;
-	float radiusB = bodyB->radius;
+	real radiusA = bodyA->radius;
+	real radiusB = bodyB->radius;
 
 	Vec2 d = posB - posA;
-	float distSquared = Dot(d, d);
-	float radiusSum = radiusA + radiusB;
+	real distSquared = Dot(d, d);
+	real radiusSum = radiusA + radiusB;
 
 
-	if (distSquared <= radiusSum * radiusSum)
+	if (distSquared <= (radiusSum + margin) * (radiusSum + margin))
 	{
-		float dist = sqrt(distSquared);
+		real dist = Sqrt(distSquared);
 		Vec2 normal = dist > 0.0f ? d / dist : Vec2(1.0f, 0.0f);
 
-		normal *= radiusA;
-
-		contacts[0].position = posA + normal;
+		contacts[0].position = posA + radiusA * normal;
 		contacts[0].normal = normal;
 		contacts[0].separation = dist - radiusSum;
 		return 1;
@@ -596,32 +602,32 @@ int CircleToCircle(Body* bodyA, Body* bodyB, Contact* contacts)
 	return 0;
 }
 
-int Collide(Contact* contacts, Body* bodyA, Body* bodyB)
+int Collide(Contact* contacts, Body* bodyA, Body* bodyB, real margin)
 {
 	if (bodyA->shape == BOX && bodyB->shape == BOX)
 	{
-		return BoxToBox(bodyA, bodyB, contacts);
+		return BoxToBox(bodyA, bodyB, contacts, margin);
 	}
 	else if (bodyA->shape == CIRCLE && bodyB->shape == CIRCLE)
 	{
-		return CircleToCircle(bodyA, bodyB, contacts);
+		return CircleToCircle(bodyA, bodyB, contacts, margin);
 	}
 	else if ((bodyA->shape == BOX && bodyB->shape == CIRCLE) || (bodyA->shape == CIRCLE && bodyB->shape == BOX))
 	{
-		return BoxToCircle(bodyB, bodyA, contacts); 
+		return BoxToCircle(bodyA, bodyB, contacts, margin);
 	}
 	else if (bodyA->shape == TRIANGLE && bodyB->shape == TRIANGLE)
 	{
-		return TriangleToTriangle(bodyA, bodyB, contacts);
+		return TriangleToTriangle(bodyA, bodyB, contacts, margin);
 	}
 	else if ((bodyA->shape == CIRCLE && bodyB->shape == TRIANGLE) || (bodyA->shape == TRIANGLE && bodyB->shape == CIRCLE))
 	{
-		return CircleToTriangle(bodyA, bodyB, contacts);
+		return CircleToTriangle(bodyA, bodyB, contacts, margin);
 		
 	}
 	else if ((bodyA->shape == BOX && bodyB->shape == TRIANGLE) || (bodyA->shape == TRIANGLE && bodyB->shape == BOX))
 	{
-		return BoxToTriangle(bodyA, bodyB, contacts);
+		return BoxToTriangle(bodyA, bodyB, contacts, margin);
 	}
 	else {
 		return 0;
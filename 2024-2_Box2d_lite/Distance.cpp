@@ -0,0 +1,482 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+#include "Distance.h"
+
+void ShapeProxy::Set(EShape shape, const Vec2& width)
+{
+	Vec2 h = 0.5f * width;
+
+	if (shape == CIRCLE)
+	{
+		vertices[0].Set(0.0f, 0.0f);
+		normals[0].Set(0.0f, 0.0f);
+		count = 1;
+		radius = h.x;
+		return;
+	}
+
+	if (shape == BOX)
+	{
+		vertices[0].Set(-h.x, -h.y);
+		vertices[1].Set( h.x, -h.y);
+		vertices[2].Set( h.x,  h.y);
+		vertices[3].Set(-h.x,  h.y);
+		count = 4;
+	}
+	else
+	{
+		vertices[0].Set(-h.x, -h.y);
+		vertices[1].Set( h.x, -h.y);
+		vertices[2].Set(0.0f,  h.y);
+		count = 3;
+	}
+	radius = 0.0f;
+
+	// Counter-clockwise winding, outward edge normals.
+	for (int i = 0; i < count; ++i)
+	{
+		Vec2 edge = vertices[i + 1 < count ? i + 1 : 0] - vertices[i];
+		normals[i] = Cross(edge, 1.0f).Normalize();
+	}
+}
+
+int ShapeProxy::GetSupport(const Vec2& d) const
+{
+	int best = 0;
+	real bestValue = Dot(vertices[0], d);
+	for (int i = 1; i < count; ++i)
+	{
+		real value = Dot(vertices[i], d);
+		if (value > bestValue)
+		{
+			best = i;
+			bestValue = value;
+		}
+	}
+	return best;
+}
+
+bool ShapeProxy::RayCast(const Transform& xf, const Vec2& p1, const Vec2& p2, real maxFraction,
+						 real& fraction, Vec2& normal) const
+{
+	Mat22 RotT = xf.R.Transpose();
+	Vec2 a = RotT * (p1 - xf.p);
+	Vec2 d = RotT * (p2 - p1);
+
+	if (count == 1)
+	{
+		Vec2 s = a - vertices[0];
+		real b = Dot(s, s) - radius * radius;
+		real c = Dot(s, d);
+		real rr = Dot(d, d);
+		real sigma = c * c - rr * b;
+		if (sigma < 0.0f || rr < k_epsilon)
+			return false;
+
+		real t = -(c + Sqrt(sigma));
+		if (t < 0.0f || t > maxFraction * rr)
+			return false;
+
+		fraction = t / rr;
+		normal = xf.R * (s + fraction * d).Normalize();
+		return true;
+	}
+
+	real lower = 0.0f, upper = maxFraction;
+	int index = -1;
+
+	for (int i = 0; i < count; ++i)
+	{
+		real numerator = Dot(normals[i], vertices[i] - a);
+		real denominator = Dot(normals[i], d);
+
+		if (denominator == 0.0f)
+		{
+			if (numerator < 0.0f)
+				return false;
+		}
+		else if (denominator < 0.0f && numerator < lower * denominator)
+		{
+			lower = numerator / denominator;
+			index = i;
+		}
+		else if (denominator > 0.0f && numerator < upper * denominator)
+		{
+			upper = numerator / denominator;
+		}
+
+		if (upper < lower)
+			return false;
+	}
+
+	if (index < 0)
+		return false;
+
+	fraction = lower;
+	normal = xf.R * normals[index];
+	return true;
+}
+
+// Support points of the Minkowski difference B - A.
+struct SimplexVertex
+{
+	Vec2 wA, wB, w;
+	real a;		// barycentric coordinate of the closest point
+	int indexA, indexB;
+};
+
+struct Simplex
+{
+	void Solve2();
+	void Solve3();
+	Vec2 GetSearchDirection() const;
+	void GetWitnessPoints(Vec2& pA, Vec2& pB) const;
+
+	SimplexVertex v[3];
+	int count;
+};
+
+void Simplex::Solve2()
+{
+	Vec2 w1 = v[0].w;
+	Vec2 w2 = v[1].w;
+	Vec2 e12 = w2 - w1;
+
+	// w1 region
+	real d12_2 = -Dot(w1, e12);
+	if (d12_2 <= 0.0f)
+	{
+		v[0].a = 1.0f;
+		count = 1;
+		return;
+	}
+
+	// w2 region
+	real d12_1 = Dot(w2, e12);
+	if (d12_1 <= 0.0f)
+	{
+		v[1].a = 1.0f;
+		v[0] = v[1];
+		count = 1;
+		return;
+	}
+
+	// Edge region
+	real inv = 1.0f / (d12_1 + d12_2);
+	v[0].a = d12_1 * inv;
+	v[1].a = d12_2 * inv;
+	count = 2;
+}
+
+void Simplex::Solve3()
+{
+	Vec2 w1 = v[0].w;
+	Vec2 w2 = v[1].w;
+	Vec2 w3 = v[2].w;
+
+	Vec2 e12 = w2 - w1;
+	real d12_1 = Dot(w2, e12);
+	real d12_2 = -Dot(w1, e12);
+
+	Vec2 e13 = w3 - w1;
+	real d13_1 = Dot(w3, e13);
+	real d13_2 = -Dot(w1, e13);
+
+	Vec2 e23 = w3 - w2;
+	real d23_1 = Dot(w3, e23);
+	real d23_2 = -Dot(w2, e23);
+
+	real n123 = Cross(e12, e13);
+	real d123_1 = n123 * Cross(w2, w3);
+	real d123_2 = n123 * Cross(w3, w1);
+	real d123_3 = n123 * Cross(w1, w2);
+
+	if (d12_2 <= 0.0f && d13_2 <= 0.0f)
+	{
+		v[0].a = 1.0f;
+		count = 1;
+		return;
+	}
+
+	if (d12_1 > 0.0f && d12_2 > 0.0f && d123_3 <= 0.0f)
+	{
+		real inv = 1.0f / (d12_1 + d12_2);
+		v[0].a = d12_1 * inv;
+		v[1].a = d12_2 * inv;
+		count = 2;
+		return;
+	}
+
+	if (d13_1 > 0.0f && d13_2 > 0.0f && d123_2 <= 0.0f)
+	{
+		real inv = 1.0f / (d13_1 + d13_2);
+		v[0].a = d13_1 * inv;
+		v[2].a = d13_2 * inv;
+		v[1] = v[2];
+		count = 2;
+		return;
+	}
+
+	if (d12_1 <= 0.0f && d23_2 <= 0.0f)
+	{
+		v[1].a = 1.0f;
+		v[0] = v[1];
+		count = 1;
+		return;
+	}
+
+	if (d13_1 <= 0.0f && d23_1 <= 0.0f)
+	{
+		v[2].a = 1.0f;
+		v[0] = v[2];
+		count = 1;
+		return;
+	}
+
+	if (d23_1 > 0.0f && d23_2 > 0.0f && d123_1 <= 0.0f)
+	{
+		real inv = 1.0f / (d23_1 + d23_2);
+		v[1].a = d23_1 * inv;
+		v[2].a = d23_2 * inv;
+		v[0] = v[2];
+		count = 2;
+		return;
+	}
+
+	// Origin inside the triangle: the shapes overlap.
+	real inv = 1.0f / (d123_1 + d123_2 + d123_3);
+	v[0].a = d123_1 * inv;
+	v[1].a = d123_2 * inv;
+	v[2].a = d123_3 * inv;
+	count = 3;
+}
+
+Vec2 Simplex::GetSearchDirection() const
+{
+	if (count == 1)
+		return -1.0f * v[0].w;
+
+	Vec2 e12 = v[1].w - v[0].w;
+	real sgn = Cross(e12, -1.0f * v[0].w);
+	return sgn > 0.0f ? Cross(1.0f, e12) : Cross(e12, 1.0f);
+}
+
+void Simplex::GetWitnessPoints(Vec2& pA, Vec2& pB) const
+{
+	switch (count)
+	{
+	case 1:
+		pA = v[0].wA;
+		pB = v[0].wB;
+		break;
+
+	case 2:
+		pA = v[0].a * v[0].wA + v[1].a * v[1].wA;
+		pB = v[0].a * v[0].wB + v[1].a * v[1].wB;
+		break;
+
+	default:
+		pA = v[0].a * v[0].wA + v[1].a * v[1].wA + v[2].a * v[2].wA;
+		pB = pA;
+		break;
+	}
+}
+
+static void SetVertex(SimplexVertex& sv, int indexA, int indexB,
+					  const ShapeProxy& proxyA, const Transform& xfA,
+					  const ShapeProxy& proxyB, const Transform& xfB)
+{
+	sv.indexA = indexA;
+	sv.indexB = indexB;
+	sv.wA = xfA.Apply(proxyA.vertices[indexA]);
+	sv.wB = xfB.Apply(proxyB.vertices[indexB]);
+	sv.w = sv.wB - sv.wA;
+	sv.a = 1.0f;
+}
+
+real Distance(const ShapeProxy& proxyA, const Transform& xfA,
+			   const ShapeProxy& proxyB, const Transform& xfB,
+			   Vec2& pointA, Vec2& pointB)
+{
+	const int k_maxIterations = 20;
+
+	Simplex simplex;
+	SetVertex(simplex.v[0], 0, 0, proxyA, xfA, proxyB, xfB);
+	simplex.count = 1;
+
+	for (int iter = 0; iter < k_maxIterations; ++iter)
+	{
+		int saveA[3], saveB[3];
+		int saveCount = simplex.count;
+		for (int i = 0; i < saveCount; ++i)
+		{
+			saveA[i] = simplex.v[i].indexA;
+			saveB[i] = simplex.v[i].indexB;
+		}
+
+		if (simplex.count == 2)
+			simplex.Solve2();
+		else if (simplex.count == 3)
+			simplex.Solve3();
+
+		if (simplex.count == 3)
+			break;
+
+		Vec2 d = simplex.GetSearchDirection();
+		if (Dot(d, d) < k_epsilon * k_epsilon)
+			break;
+
+		int indexA = proxyA.GetSupport(xfA.R.Transpose() * (-1.0f * d));
+		int indexB = proxyB.GetSupport(xfB.R.Transpose() * d);
+
+		// A repeated support point means no further progress is possible.
+		bool duplicate = false;
+		for (int i = 0; i < saveCount; ++i)
+		{
+			if (saveA[i] == indexA && saveB[i] == indexB)
+			{
+				duplicate = true;
+				break;
+			}
+		}
+		if (duplicate)
+			break;
+
+		SetVertex(simplex.v[simplex.count], indexA, indexB, proxyA, xfA, proxyB, xfB);
+		++simplex.count;
+	}
+
+	simplex.GetWitnessPoints(pointA, pointB);
+	real distance = (pointB - pointA).Length();
+
+	// Move the core witness points out to the rounded surfaces.
+	real rA = proxyA.radius, rB = proxyB.radius;
+	if (distance > rA + rB && distance > k_epsilon)
+	{
+		Vec2 n = (pointB - pointA) / distance;
+		pointA += rA * n;
+		pointB -= rB * n;
+		return distance - rA - rB;
+	}
+
+	Vec2 p = 0.5f * (pointA + pointB);
+	pointA = p;
+	pointB = p;
+	return 0.0f;
+}
+
+bool ShapeCast(const ShapeProxy& proxyA, const Transform& xfA, const Vec2& translation,
+			   const ShapeProxy& proxyB, const Transform& xfB,
+			   real& fraction, Vec2& point, Vec2& normal)
+{
+	const int k_maxIterations = 20;
+	const real k_target = 0.005f;
+	const real k_tolerance = 0.25f * k_target;
+
+	Transform xf = xfA;
+	real t = 0.0f;
+
+	for (int iter = 0; iter < k_maxIterations; ++iter)
+	{
+		xf.p = xfA.p + t * translation;
+
+		Vec2 pA, pB;
+		real distance = Distance(proxyA, xf, proxyB, xfB, pA, pB);
+
+		if (distance < k_target + k_tolerance)
+		{
+			fraction = t;
+			point = pB;
+			normal = distance > 0.0f ? (pA - pB).Normalize() : Vec2(0.0f, 0.0f);
+			return true;
+		}
+
+		// Advance by the distance over the closing speed along the
+		// separating axis; this never steps past the first contact.
+		Vec2 n = (pB - pA) / (pA - pB).Length();
+		real approach = Dot(translation, n);
+		if (approach <= 0.0f)
+			return false;
+
+		t += (distance - k_target) / approach;
+		if (t > 1.0f)
+			return false;
+	}
+
+	xf.p = xfA.p + t * translation;
+	Vec2 pA, pB;
+	Distance(proxyA, xf, proxyB, xfB, pA, pB);
+	fraction = t;
+	point = pB;
+	normal = (pA - pB).Normalize();
+	return true;
+}
+
+bool TimeOfImpact(const ShapeProxy& proxyA, const Vec2& p0, real a0, const Vec2& p1, real a1,
+				  const ShapeProxy& proxyB, const Transform& xfB,
+				  real& toi, Vec2& normal)
+{
+	const int k_maxIterations = 30;
+	const real k_target = 0.005f;
+	const real k_tolerance = 0.25f * k_target;
+
+	Vec2 dp = p1 - p0;
+	real da = a1 - a0;
+
+	// No point of A moves faster than the center plus rotation at the
+	// farthest vertex.
+	real maxExtent = 0.0f;
+	for (int i = 0; i < proxyA.count; ++i)
+		maxExtent = Max(maxExtent, proxyA.vertices[i].Length());
+	maxExtent += proxyA.radius;
+
+	real t = 0.0f;
+	for (int iter = 0; iter < k_maxIterations; ++iter)
+	{
+		Transform xfA(p0 + t * dp, a0 + t * da);
+
+		Vec2 pA, pB;
+		real distance = Distance(proxyA, xfA, proxyB, xfB, pA, pB);
+
+		// Overlap at the start is left to the discrete solver.
+		if (distance <= 0.0f)
+			return false;
+
+		Vec2 n = (pB - pA) / (pB - pA).Length();
+
+		if (distance < k_target + k_tolerance)
+		{
+			// Touching; only report it if the sweep presses into B.
+			if (t == 0.0f && Dot(dp, n) <= 0.0f)
+				return false;
+
+			toi = t;
+			normal = -1.0f * n;
+			return true;
+		}
+
+		real bound = Dot(dp, n) + Abs(da) * maxExtent;
+		if (bound <= 0.0f)
+			return false;
+
+		t += (distance - k_target) / bound;
+		if (t >= 1.0f)
+			return false;
+	}
+
+	Transform xfA(p0 + t * dp, a0 + t * da);
+	Vec2 pA, pB;
+	Distance(proxyA, xfA, proxyB, xfB, pA, pB);
+	toi = t;
+	normal = (pA - pB).Normalize();
+	return true;
+}
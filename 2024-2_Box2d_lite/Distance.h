@@ -0,0 +1,75 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+#ifndef DISTANCE_H
+#define DISTANCE_H
+
+#include "MathUtils.h"
+#include "Body.h"
+
+struct Transform
+{
+	Transform() {}
+	Transform(const Vec2& p, real angle) : p(p), R(angle) {}
+
+	Vec2 Apply(const Vec2& v) const { return p + R * v; }
+
+	Vec2 p;
+	Mat22 R;
+};
+
+// Convex outline of a body shape in local coordinates: a polygon, or a
+// single vertex with a radius for circles. Unlike Collide, queries built on
+// this honor rotation for every shape.
+struct ShapeProxy
+{
+	ShapeProxy() : count(0), radius(0.0f) {}
+
+	void Set(const Body* body) { Set(body->shape, body->width); }
+	void Set(EShape shape, const Vec2& width);
+
+	int GetSupport(const Vec2& d) const;
+
+	// Clips the segment p1 + t * (p2 - p1), t in [0, maxFraction], against
+	// the shape. Segments starting inside the shape do not hit.
+	bool RayCast(const Transform& xf, const Vec2& p1, const Vec2& p2, real maxFraction,
+		real& fraction, Vec2& normal) const;
+
+	Vec2 vertices[4];
+	Vec2 normals[4];
+	int count;
+	real radius;
+};
+
+// GJK distance between two proxies, zero when they overlap. The witness
+// points lie on the shape surfaces.
+real Distance(const ShapeProxy& proxyA, const Transform& xfA,
+			   const ShapeProxy& proxyB, const Transform& xfB,
+			   Vec2& pointA, Vec2& pointB);
+
+// Conservative advancement of proxyA moving by translation (no rotation)
+// against a fixed proxyB. On a hit, fraction is the time of first contact,
+// point lies on proxyB and normal points from proxyB towards proxyA. A cast
+// that starts in contact hits at fraction 0; the normal is zero if the
+// shapes overlap.
+bool ShapeCast(const ShapeProxy& proxyA, const Transform& xfA, const Vec2& translation,
+			   const ShapeProxy& proxyB, const Transform& xfB,
+			   real& fraction, Vec2& point, Vec2& normal);
+
+// Time of impact of proxyA sweeping linearly from (p0, a0) to (p1, a1)
+// against a fixed proxyB, by conservative advancement bounded by the
+// angular motion. toi is in [0, 1] and normal points from proxyB towards
+// proxyA. Pairs that already overlap or are not closing do not hit.
+bool TimeOfImpact(const ShapeProxy& proxyA, const Vec2& p0, real a0, const Vec2& p1, real a1,
+				  const ShapeProxy& proxyB, const Transform& xfB,
+				  real& toi, Vec2& normal);
+
+#endif
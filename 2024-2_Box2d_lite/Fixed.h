@@ -0,0 +1,115 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+#ifndef FIXED_H
+#define FIXED_H
+
+// Q16.16 fixed-point scalar for lockstep simulation. Every operation is
+// integer arithmetic, so results are bit-identical on any compiler and
+// CPU. The range is about +-32767 with a resolution of 1/65536; results
+// saturate instead of wrapping, so FLT_MAX style sentinels become the
+// largest representable value and division by zero gives +-max.
+struct Fixed
+{
+	enum
+	{
+		FRACTION_BITS = 16,
+		ONE = 1 << FRACTION_BITS
+	};
+
+	Fixed() {}
+	Fixed(int i) : raw(Saturate((long long)i * ONE)) {}
+	Fixed(float f) : raw(FromReal((double)f)) {}
+	Fixed(double d) : raw(FromReal(d)) {}
+
+	static Fixed FromRaw(int raw)
+	{
+		Fixed f;
+		f.raw = raw;
+		return f;
+	}
+
+	explicit operator float() const { return (float)raw / ONE; }
+	explicit operator double() const { return (double)raw / ONE; }
+
+	// Truncates toward zero like a float to int cast.
+	explicit operator int() const { return raw >= 0 ? raw >> FRACTION_BITS : -(-raw >> FRACTION_BITS); }
+
+	Fixed operator - () const { return FromRaw(Saturate(-(long long)raw)); }
+
+	void operator += (Fixed b) { raw = Saturate((long long)raw + b.raw); }
+	void operator -= (Fixed b) { raw = Saturate((long long)raw - b.raw); }
+	void operator *= (Fixed b) { raw = Mul(raw, b.raw); }
+	void operator /= (Fixed b) { raw = Div(raw, b.raw); }
+
+	static int Saturate(long long x)
+	{
+		return x > 0x7FFFFFFF ? 0x7FFFFFFF : (x < -0x7FFFFFFF ? -0x7FFFFFFF : (int)x);
+	}
+
+	// Rounds to nearest.
+	static int Mul(int a, int b)
+	{
+		long long p = (long long)a * b;
+		return Saturate((p + (1 << (FRACTION_BITS - 1))) >> FRACTION_BITS);
+	}
+
+	// Truncates toward zero.
+	static int Div(int a, int b)
+	{
+		if (b == 0)
+			return a >= 0 ? 0x7FFFFFFF : -0x7FFFFFFF;
+		return Saturate((long long)a * ONE / b);
+	}
+
+	// Only used for constants and data entering the simulation. The
+	// multiply by a power of two is exact, so conversion is deterministic.
+	static int FromReal(double d)
+	{
+		d *= ONE;
+		if (d != d)
+			return 0;
+		if (d >= 2147483647.0)
+			return 0x7FFFFFFF;
+		if (d <= -2147483647.0)
+			return -0x7FFFFFFF;
+		return (int)(d >= 0.0 ? d + 0.5 : d - 0.5);
+	}
+
+	int raw;
+};
+
+inline Fixed operator + (Fixed a, Fixed b) { return Fixed::FromRaw(Fixed::Saturate((long long)a.raw + b.raw)); }
+inline Fixed operator - (Fixed a, Fixed b) { return Fixed::FromRaw(Fixed::Saturate((long long)a.raw - b.raw)); }
+inline Fixed operator * (Fixed a, Fixed b) { return Fixed::FromRaw(Fixed::Mul(a.raw, b.raw)); }
+inline Fixed operator / (Fixed a, Fixed b) { return Fixed::FromRaw(Fixed::Div(a.raw, b.raw)); }
+
+inline bool operator == (Fixed a, Fixed b) { return a.raw == b.raw; }
+inline bool operator != (Fixed a, Fixed b) { return a.raw != b.raw; }
+inline bool operator < (Fixed a, Fixed b) { return a.raw < b.raw; }
+inline bool operator > (Fixed a, Fixed b) { return a.raw > b.raw; }
+inline bool operator <= (Fixed a, Fixed b) { return a.raw <= b.raw; }
+inline bool operator >= (Fixed a, Fixed b) { return a.raw >= b.raw; }
+
+inline Fixed FixedFloor(Fixed x)
+{
+	return Fixed::FromRaw(x.raw & ~(Fixed::ONE - 1));
+}
+
+// Exact floor of the square root, 0 for negative input.
+Fixed FixedSqrt(Fixed x);
+
+// Quarter-wave table with linear interpolation. Max error is 2 units of
+// the last place (3e-5). The angle is reduced modulo a rounded 2 pi, which
+// adds about 3e-6 rad of phase error per revolution.
+void FixedSinCos(Fixed angle, Fixed& s, Fixed& c);
+
+#endif
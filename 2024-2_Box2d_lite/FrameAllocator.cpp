@@ -0,0 +1,88 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+#include "FrameAllocator.h"
+
+#include <stdlib.h>
+#include <new>
+
+// Keeps every allocation, and the overflow header, 16 byte aligned.
+static const int k_alignment = 16;
+
+static int AlignSize(int size)
+{
+	return (size + k_alignment - 1) & ~(k_alignment - 1);
+}
+
+FrameAllocator::FrameAllocator(int capacity) : capacity(AlignSize(capacity)), index(0),
+	allocation(0), maxAllocation(0), overflow(NULL)
+{
+	data = (char*)malloc(this->capacity);
+	if (data == NULL)
+		throw std::bad_alloc();
+}
+
+FrameAllocator::~FrameAllocator()
+{
+	Reset();
+	free(data);
+}
+
+void* FrameAllocator::Allocate(int size)
+{
+	if (size <= 0)
+		return NULL;
+
+	size = AlignSize(size);
+	allocation += size;
+	if (allocation > maxAllocation)
+		maxAllocation = allocation;
+
+	if (index + size <= capacity)
+	{
+		void* p = data + index;
+		index += size;
+		return p;
+	}
+
+	Overflow* block = (Overflow*)malloc(k_alignment + size);
+	if (block == NULL)
+		throw std::bad_alloc();
+	block->next = overflow;
+	overflow = block;
+	return (char*)block + k_alignment;
+}
+
+void FrameAllocator::Reset()
+{
+	bool grow = overflow != NULL;
+
+	while (overflow)
+	{
+		Overflow* next = overflow->next;
+		free(overflow);
+		overflow = next;
+	}
+
+	if (grow && maxAllocation > capacity)
+	{
+		char* larger = (char*)malloc(maxAllocation);
+		if (larger != NULL)
+		{
+			free(data);
+			data = larger;
+			capacity = maxAllocation;
+		}
+	}
+
+	index = 0;
+	allocation = 0;
+}
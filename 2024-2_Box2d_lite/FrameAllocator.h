@@ -0,0 +1,54 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+#ifndef FRAMEALLOCATOR_H
+#define FRAMEALLOCATOR_H
+
+// Linear allocator for data that lives for a single World::Step. Memory is
+// bumped from one buffer and released all at once by Reset. A frame that
+// outgrows the buffer falls back to malloc, and the next Reset grows the
+// buffer to the high-water mark so steady-state steps never hit the heap.
+struct FrameAllocator
+{
+	explicit FrameAllocator(int capacity = 64 * 1024);
+	~FrameAllocator();
+
+	void* Allocate(int size);
+
+	template<typename T> T* Allocate(int count)
+	{
+		return (T*)Allocate(count * (int)sizeof(T));
+	}
+
+	void Reset();
+
+	int GetAllocation() const { return allocation; }			// bytes this frame
+	int GetHighWaterMark() const { return maxAllocation; }		// bytes, any frame
+	int GetCapacity() const { return capacity; }
+
+private:
+	FrameAllocator(const FrameAllocator&);
+	void operator = (const FrameAllocator&);
+
+	struct Overflow
+	{
+		Overflow* next;
+	};
+
+	char* data;
+	int capacity;
+	int index;
+	int allocation;
+	int maxAllocation;
+	Overflow* overflow;
+};
+
+#endif
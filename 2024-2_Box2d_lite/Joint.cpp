@@ -32,7 +32,44 @@ void Joint::Set(Body* b1, Body* b2, const Vec2& anchor)
 	biasFactor = 0.2f;
 }
 
-void Joint::PreStep(float inv_dt)
+static void LinkEdge(JointEdge* edge, Body* body)
+{
+	edge->prev = NULL;
+	edge->next = body->jointList;
+	if (body->jointList)
+		body->jointList->prev = edge;
+	body->jointList = edge;
+}
+
+static void UnlinkEdge(JointEdge* edge, Body* body)
+{
+	if (edge->prev)
+		edge->prev->next = edge->next;
+	else
+		body->jointList = edge->next;
+
+	if (edge->next)
+		edge->next->prev = edge->prev;
+}
+
+void Joint::Link()
+{
+	node1.other = body2;
+	node1.joint = this;
+	LinkEdge(&node1, body1);
+
+	node2.other = body1;
+	node2.joint = this;
+	LinkEdge(&node2, body2);
+}
+
+void Joint::Unlink()
+{
+	UnlinkEdge(&node1, body1);
+	UnlinkEdge(&node2, body2);
+}
+
+void Joint::PreStep(real inv_dt, const SolverConfig& config)
 {
 	// Pre-compute anchors, mass matrix, and bias.
 	Mat22 Rot1(body1->rotation);
@@ -67,7 +104,7 @@ void Joint::PreStep(float inv_dt)
 	Vec2 p2 = body2->position + r2;
 	Vec2 dp = p2 - p1;
 
-	if (World::positionCorrection)
+	if (config.positionCorrection)
 	{
 		bias = -biasFactor * inv_dt * dp;
 	}
@@ -76,7 +113,7 @@ void Joint::PreStep(float inv_dt)
 		bias.Set(0.0f, 0.0f);
 	}
 
-	if (World::warmStarting)
+	if (config.warmStarting)
 	{
 		// Apply accumulated impulse.
 		body1->velocity -= body1->invMass * P;
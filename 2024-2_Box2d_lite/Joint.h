@@ -13,20 +13,38 @@
 #define JOINT_H
 
 #include "MathUtils.h"
+#include "Pool.h"
 
 struct Body;
+struct Joint;
+struct SolverConfig;
+
+// Node in a body's list of joints; each joint owns one per body.
+struct JointEdge
+{
+	Body* other;
+	Joint* joint;
+	JointEdge* prev;
+	JointEdge* next;
+};
 
 struct Joint
 {
 	Joint() :
-		body1(0), body2(0),
 		P(0.0f, 0.0f),
-		biasFactor(0.2f), softness(0.0f)
+		body1(0), body2(0),
+		biasFactor(0.2f), softness(0.0f), index(-1)
 		{}
 
+	// Call before adding the joint to a World; the bodies' joint lists
+	// are linked when it is added.
 	void Set(Body* body1, Body* body2, const Vec2& anchor);
 
-	void PreStep(float inv_dt);
+	// Adds or removes the joint in both bodies' joint lists. Done by World.
+	void Link();
+	void Unlink();
+
+	void PreStep(real inv_dt, const SolverConfig& config);
 	void ApplyImpulse();
 
 	Mat22 M;
@@ -36,8 +54,14 @@ struct Joint
 	Vec2 P;		// accumulated impulse
 	Body* body1;
 	Body* body2;
-	float biasFactor;
-	float softness;
+	real biasFactor;
+	real softness;
+
+	int index;	// position in World::joints
+	Handle<Joint> handle;	// set by World::CreateJoint; null if added directly
+
+	JointEdge node1;	// in body1->jointList
+	JointEdge node2;	// in body2->jointList
 };
 
 #endif
\ No newline at end of file
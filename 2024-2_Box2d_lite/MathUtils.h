@@ -17,14 +17,164 @@
 #include <assert.h>
 #include <stdlib.h>
 
-const float k_pi = 3.14159265358979323846264f;
+// Define BOX2D_DETERMINISTIC for bitwise reproducible results across
+// compilers and machines: no contraction into fused multiply-add, no
+// reassociation, and trig computed without the platform libm.
+#if defined(BOX2D_DETERMINISTIC)
+#if defined(_MSC_VER)
+#pragma float_control(precise, on)
+#pragma fp_contract(off)
+#elif defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize("fp-contract=off", "no-fast-math")
+#elif defined(__clang__)
+#pragma clang fp contract(off)
+#endif
+#endif
+
+// Scalar type of the math layer and the physics core. Define BOX2D_DOUBLE
+// for double precision, e.g. for worlds much larger than the demo's, or
+// BOX2D_FIXED for the Q16.16 type in Fixed.h, which gives bit-identical
+// results on every compiler and CPU for lockstep play. Scene and replay
+// files store float either way.
+#if defined(BOX2D_FIXED)
+#include "Fixed.h"
+typedef Fixed real;
+#elif defined(BOX2D_DOUBLE)
+typedef double real;
+#else
+typedef float real;
+#endif
+
+// Define BOX2D_SIMD to run the batch kernels below with SSE2 or NEON when
+// the target has them; other targets and non-float builds keep the scalar
+// loops.
+#if defined(BOX2D_SIMD) && !defined(BOX2D_DOUBLE) && !defined(BOX2D_FIXED)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BOX2D_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define BOX2D_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+// Define BOX2D_FAST_MATH to replace libm in the hot paths with shorter
+// polynomials for SinCos and an estimated reciprocal square root refined
+// by Newton steps. Error bounds are given at each function. Ignored when
+// BOX2D_DETERMINISTIC is defined, since estimate instructions differ
+// between CPU vendors, and in non-float builds.
+#if defined(BOX2D_FAST_MATH) && !defined(BOX2D_DETERMINISTIC) && !defined(BOX2D_DOUBLE) && !defined(BOX2D_FIXED)
+#define BOX2D_USE_FAST_MATH
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define BOX2D_FAST_RSQRT_SSE
+#include <xmmintrin.h>
+#endif
+#endif
+
+const real k_pi = (real)3.14159265358979323846264;
+
+// Smallest length the geometric queries treat as non-zero.
+#if defined(BOX2D_FIXED)
+const real k_epsilon = Fixed::FromRaw(1);
+#else
+const real k_epsilon = FLT_EPSILON;
+#endif
+
+inline real Floor(real x)
+{
+#if defined(BOX2D_FIXED)
+	return FixedFloor(x);
+#elif defined(BOX2D_DOUBLE)
+	return floor(x);
+#else
+	return floorf(x);
+#endif
+}
+
+inline void SinCos(real angle, real& s, real& c)
+{
+#if defined(BOX2D_FIXED)
+	FixedSinCos(angle, s, c);
+#elif defined(BOX2D_DETERMINISTIC) || defined(BOX2D_USE_FAST_MATH)
+	// Reduce to [-pi/4, pi/4] and evaluate polynomials using only IEEE add
+	// and multiply.
+	real q = Floor(angle * (2.0f / k_pi) + 0.5f);
+	real x = angle - q * 1.5703125f;		// pi/2 split in two parts
+	x -= q * 4.8382679e-4f;
+	real x2 = x * x;
+#if defined(BOX2D_DETERMINISTIC)
+	// Taylor series. Max error is about 1e-7 near the quadrant edges.
+	real sn = x * (1.0f + x2 * (-1.0f / 6.0f + x2 * (1.0f / 120.0f + x2 * (-1.0f / 5040.0f + x2 * (1.0f / 362880.0f)))));
+	real cs = 1.0f + x2 * (-0.5f + x2 * (1.0f / 24.0f + x2 * (-1.0f / 720.0f + x2 * (1.0f / 40320.0f))));
+#else
+	// Least-squares fits on [-pi/4, pi/4]. Max absolute error is 1.2e-6
+	// for |angle| up to 1e4.
+	real sn = x * (1.0f + x2 * (-0.16662756f + x2 * 0.0081515894f));
+	real cs = 1.0f + x2 * (-0.49999892f + x2 * (0.041656182f + x2 * -0.0013596604f));
+#endif
+
+	switch ((int)q & 3)
+	{
+	case 0: s = sn; c = cs; break;
+	case 1: s = cs; c = -sn; break;
+	case 2: s = -sn; c = -cs; break;
+	default: s = -cs; c = sn; break;
+	}
+#elif defined(BOX2D_DOUBLE)
+	s = sin(angle);
+	c = cos(angle);
+#else
+	s = sinf(angle);
+	c = cosf(angle);
+#endif
+}
+
+// 1 / sqrt(x) for x >= FLT_MIN.
+inline real InvSqrt(real x)
+{
+#if defined(BOX2D_FAST_RSQRT_SSE)
+	// 12-bit hardware estimate plus one Newton step. Max relative error
+	// is 3e-7.
+	real y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+	return y * (1.5f - 0.5f * x * y * y);
+#elif defined(BOX2D_USE_FAST_MATH)
+	// Bit-level estimate plus two Newton steps. Max relative error is 5e-6.
+	union { float f; unsigned int i; } u;
+	u.f = x;
+	u.i = 0x5f375a86 - (u.i >> 1);
+	real y = u.f;
+	y = y * (1.5f - 0.5f * x * y * y);
+	return y * (1.5f - 0.5f * x * y * y);
+#elif defined(BOX2D_FIXED)
+	return 1 / FixedSqrt(x);
+#elif defined(BOX2D_DOUBLE)
+	return 1.0 / sqrt(x);
+#else
+	return 1.0f / sqrtf(x);
+#endif
+}
+
+// sqrtf, or x * InvSqrt(x) under BOX2D_FAST_MATH with the same relative
+// error as InvSqrt. Inputs below FLT_MIN give 0.
+inline real Sqrt(real x)
+{
+#if defined(BOX2D_USE_FAST_MATH)
+	return x < FLT_MIN ? 0.0f : x * InvSqrt(x);
+#elif defined(BOX2D_FIXED)
+	return FixedSqrt(x);
+#elif defined(BOX2D_DOUBLE)
+	return sqrt(x);
+#else
+	return sqrtf(x);
+#endif
+}
 
 struct Vec2
 {
 	Vec2() {}
-	Vec2(float x, float y) : x(x), y(y) {}
+	Vec2(real x, real y) : x(x), y(y) {}
 
-	void Set(float x_, float y_) { x = x_; y = y_; }
+	void Set(real x_, real y_) { x = x_; y = y_; }
 
 	Vec2 operator -() { return Vec2(-x, -y); }
 	
@@ -39,39 +189,40 @@ struct Vec2
 	}
 
 
-	Vec2 operator * (float a)
+	Vec2 operator * (real a)
 	{
 		return Vec2(x * a, y * a);
 	}
 
-	void operator *= (float a)
+	void operator *= (real a)
 	{
 		x *= a; y *= a;
 	}
-	Vec2 operator / (float a) const
+	Vec2 operator / (real a) const
 	{
 		return Vec2(x / a, y / a);
 	}
-	float Length() const
+	real Length() const
 	{
-		return sqrtf(x * x + y * y);
+		return Sqrt(x * x + y * y);
 	}
 
 	Vec2 Normalize()
 	{
-		float length = sqrt(x * x + y * y);
+		real length = Sqrt(x * x + y * y);
 		return (length > 0.0f) ? Vec2(x / length, y / length) : Vec2(0, 0);
 	}
 
-	float x, y;
+	real x, y;
 };
 
 struct Mat22
 {
 	Mat22() {}
-	Mat22(float angle)
+	Mat22(real angle)
 	{
-		float c = cosf(angle), s = sinf(angle);
+		real c, s;
+		SinCos(angle, s, c);
 		col1.x = c; col2.x = -s;
 		col1.y = s; col2.y = c;
 	}
@@ -85,9 +236,9 @@ struct Mat22
 
 	Mat22 Invert() const
 	{
-		float a = col1.x, b = col2.x, c = col1.y, d = col2.y;
+		real a = col1.x, b = col2.x, c = col1.y, d = col2.y;
 		Mat22 B;
-		float det = a * d - b * c;
+		real det = a * d - b * c;
 		assert(det != 0.0f);
 		det = 1.0f / det;
 		B.col1.x =  det * d;	B.col2.x = -det * b;
@@ -98,22 +249,22 @@ struct Mat22
 	Vec2 col1, col2;
 };
 
-inline float Dot(const Vec2& a, const Vec2& b)
+inline real Dot(const Vec2& a, const Vec2& b)
 {
 	return a.x * b.x + a.y * b.y;
 }
 
-inline float Cross(const Vec2& a, const Vec2& b)
+inline real Cross(const Vec2& a, const Vec2& b)
 {
 	return a.x * b.y - a.y * b.x;
 }
 
-inline Vec2 Cross(const Vec2& a, float s)
+inline Vec2 Cross(const Vec2& a, real s)
 {
 	return Vec2(s * a.y, -s * a.x);
 }
 
-inline Vec2 Cross(float s, const Vec2& a)
+inline Vec2 Cross(real s, const Vec2& a)
 {
 	return Vec2(-s * a.y, s * a.x);
 }
@@ -133,7 +284,7 @@ inline Vec2 operator - (const Vec2& a, const Vec2& b)
 	return Vec2(a.x - b.x, a.y - b.y);
 }
 
-inline Vec2 operator * (float s, const Vec2& v)
+inline Vec2 operator * (real s, const Vec2& v)
 {
 	return Vec2(s * v.x, s * v.y);
 }
@@ -148,14 +299,75 @@ inline Mat22 operator * (const Mat22& A, const Mat22& B)
 	return Mat22(A * B.col1, A * B.col2);
 }
 
-inline float Abs(float a)
+// Batch kernels over contiguous Vec2 arrays. The SIMD paths use separate
+// multiplies and adds in the scalar order, so they give bitwise the same
+// results as the scalar loops (as long as those are not contracted into
+// FMA, which BOX2D_DETERMINISTIC rules out).
+
+// out[i] = p + R * points[i]. out may alias points.
+inline void TransformPoints(Vec2* out, const Vec2* points, int count, const Mat22& R, const Vec2& p)
+{
+	int i = 0;
+#if defined(BOX2D_SSE2)
+	__m128 c1 = _mm_setr_ps(R.col1.x, R.col1.y, R.col1.x, R.col1.y);
+	__m128 c2 = _mm_setr_ps(R.col2.x, R.col2.y, R.col2.x, R.col2.y);
+	__m128 t = _mm_setr_ps(p.x, p.y, p.x, p.y);
+	for (; i + 2 <= count; i += 2)
+	{
+		__m128 v = _mm_loadu_ps(&points[i].x);
+		__m128 xs = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 0, 0));
+		__m128 ys = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 1, 1));
+		__m128 r = _mm_add_ps(_mm_mul_ps(c1, xs), _mm_mul_ps(c2, ys));
+		_mm_storeu_ps(&out[i].x, _mm_add_ps(t, r));
+	}
+#elif defined(BOX2D_NEON)
+	for (; i + 4 <= count; i += 4)
+	{
+		float32x4x2_t v = vld2q_f32(&points[i].x);
+		float32x4x2_t r;
+		r.val[0] = vaddq_f32(vdupq_n_f32(p.x), vaddq_f32(vmulq_n_f32(v.val[0], R.col1.x), vmulq_n_f32(v.val[1], R.col2.x)));
+		r.val[1] = vaddq_f32(vdupq_n_f32(p.y), vaddq_f32(vmulq_n_f32(v.val[0], R.col1.y), vmulq_n_f32(v.val[1], R.col2.y)));
+		vst2q_f32(&out[i].x, r);
+	}
+#endif
+	for (; i < count; ++i)
+		out[i] = p + R * points[i];
+}
+
+// out[i] = Dot(points[i], d), e.g. projecting vertices onto an axis.
+inline void DotPoints(real* out, const Vec2* points, int count, const Vec2& d)
+{
+	int i = 0;
+#if defined(BOX2D_SSE2)
+	__m128 dx = _mm_set1_ps(d.x);
+	__m128 dy = _mm_set1_ps(d.y);
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 v0 = _mm_loadu_ps(&points[i].x);
+		__m128 v1 = _mm_loadu_ps(&points[i + 2].x);
+		__m128 xs = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 ys = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 1, 3, 1));
+		_mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(xs, dx), _mm_mul_ps(ys, dy)));
+	}
+#elif defined(BOX2D_NEON)
+	for (; i + 4 <= count; i += 4)
+	{
+		float32x4x2_t v = vld2q_f32(&points[i].x);
+		vst1q_f32(out + i, vaddq_f32(vmulq_n_f32(v.val[0], d.x), vmulq_n_f32(v.val[1], d.y)));
+	}
+#endif
+	for (; i < count; ++i)
+		out[i] = Dot(points[i], d);
+}
+
+inline real Abs(real a)
 {
 	return a > 0.0f ? a : -a;
 }
 
 inline Vec2 Abs(const Vec2& a)
 {
-	return Vec2(fabsf(a.x), fabsf(a.y));
+	return Vec2(Abs(a.x), Abs(a.y));
 }
 
 inline Mat22 Abs(const Mat22& A)
@@ -163,26 +375,43 @@ inline Mat22 Abs(const Mat22& A)
 	return Mat22(Abs(A.col1), Abs(A.col2));
 }
 
-inline float Sign(float x)
+inline real Sign(real x)
 {
 	return x < 0.0f ? -1.0f : 1.0f;
 }
 
-inline float Min(float a, float b)
+inline real Min(real a, real b)
 {
 	return a < b ? a : b;
 }
 
-inline float Max(float a, float b)
+inline real Max(real a, real b)
 {
 	return a > b ? a : b;
 }
 
-inline float Clamp(float a, float low, float high)
+inline real Clamp(real a, real low, real high)
 {
 	return Max(low, Min(a, high));
 }
 
+struct AABB
+{
+	Vec2 lowerBound, upperBound;
+};
+
+inline bool Overlap(const AABB& a, const AABB& b)
+{
+	return a.lowerBound.x <= b.upperBound.x && b.lowerBound.x <= a.upperBound.x
+		&& a.lowerBound.y <= b.upperBound.y && b.lowerBound.y <= a.upperBound.y;
+}
+
+inline bool Contains(const AABB& a, const Vec2& p)
+{
+	return a.lowerBound.x <= p.x && p.x <= a.upperBound.x
+		&& a.lowerBound.y <= p.y && p.y <= a.upperBound.y;
+}
+
 template<typename T> inline void Swap(T& a, T& b)
 {
 	T tmp = a;
@@ -191,20 +420,19 @@ template<typename T> inline void Swap(T& a, T& b)
 }
 
 // Random number in range [-1,1]
-inline float Random()
+inline real Random()
 {
 	float r = (float)rand();
 	r /= RAND_MAX;
 	r = 2.0f * r - 1.0f;
-	return r;
+	return (real)r;
 }
 
-inline float Random(float lo, float hi)
+inline real Random(real lo, real hi)
 {
 	float r = (float)rand();
 	r /= RAND_MAX;
-	r = (hi - lo) * r + lo;
-	return r;
+	return (hi - lo) * (real)r + lo;
 }
 
 #endif
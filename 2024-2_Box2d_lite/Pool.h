@@ -0,0 +1,123 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <vector>
+#include <stddef.h>
+
+// Slot index plus the generation it was issued for. A handle goes stale
+// once its object is destroyed, even if the slot is reused.
+template<typename T>
+struct Handle
+{
+	Handle() : index(-1), generation(0) {}
+	Handle(int index, unsigned int generation) : index(index), generation(generation) {}
+
+	bool IsNull() const { return index < 0; }
+
+	bool operator == (const Handle& h) const { return index == h.index && generation == h.generation; }
+	bool operator != (const Handle& h) const { return !(*this == h); }
+
+	int index;
+	unsigned int generation;
+};
+
+// Objects stored in fixed-size slabs that are never moved or released
+// before Clear, so pointers stay valid while the object is alive. Freed
+// slots go on a free list and are reused first; Create and Destroy are O(1).
+template<typename T, int SlabSize = 128>
+struct Pool
+{
+	Pool() : numSlots(0), count(0) {}
+	~Pool()
+	{
+		for (int i = 0; i < (int)slabs.size(); ++i)
+			delete [] slabs[i];
+	}
+
+	// The new object is a copy of def.
+	Handle<T> Create(const T& def)
+	{
+		int slot;
+		if (!freeList.empty())
+		{
+			slot = freeList.back();
+			freeList.pop_back();
+		}
+		else
+		{
+			if (numSlots == (int)slabs.size() * SlabSize)
+				slabs.push_back(new T[SlabSize]);
+			slot = numSlots++;
+			generations.push_back(0);
+			alive.push_back(0);
+		}
+
+		*Slot(slot) = def;
+		alive[slot] = 1;
+		++count;
+		return Handle<T>(slot, generations[slot]);
+	}
+
+	void Destroy(Handle<T> h)
+	{
+		if (Get(h) == NULL)
+			return;
+
+		alive[h.index] = 0;
+		++generations[h.index];
+		freeList.push_back(h.index);
+		--count;
+	}
+
+	// NULL for null or stale handles.
+	T* Get(Handle<T> h) const
+	{
+		if (h.index < 0 || h.index >= numSlots || !alive[h.index] || generations[h.index] != h.generation)
+			return NULL;
+		return Slot(h.index);
+	}
+
+	// Destroys every object; slabs are kept for reuse.
+	void Clear()
+	{
+		freeList.clear();
+		for (int i = numSlots - 1; i >= 0; --i)
+		{
+			if (alive[i])
+			{
+				alive[i] = 0;
+				++generations[i];
+			}
+			freeList.push_back(i);
+		}
+		count = 0;
+	}
+
+	int GetCount() const { return count; }
+
+private:
+	Pool(const Pool&);
+	void operator = (const Pool&);
+
+	T* Slot(int slot) const { return slabs[slot / SlabSize] + slot % SlabSize; }
+
+	std::vector<T*> slabs;
+	std::vector<unsigned int> generations;
+	std::vector<unsigned char> alive;
+	std::vector<int> freeList;		// most recently freed last
+	int numSlots;
+	int count;
+};
+
+#endif
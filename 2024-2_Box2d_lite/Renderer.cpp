@@ -0,0 +1,223 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+#include "Renderer.h"
+#include "Body.h"
+#include "Joint.h"
+
+#include "glut.h"
+#include <string.h>
+
+// Unit-circle tables for 8, 16, 32, 64 and 128 segments.
+static const int k_circleLods = 5;
+static const int k_minCircleSegments = 8;
+static const int k_maxCircleSegments = k_minCircleSegments << (k_circleLods - 1);
+
+struct UnitCircle
+{
+	UnitCircle()
+	{
+		for (int lod = 0; lod < k_circleLods; ++lod)
+		{
+			int n = k_minCircleSegments << lod;
+			for (int i = 0; i <= n; ++i)
+			{
+				float angle = 2.0f * (float)k_pi * i / n;
+				table[lod][i].Set(cosf(angle), sinf(angle));
+			}
+		}
+	}
+
+	// n + 1 points, the last repeats the first.
+	Vec2 table[k_circleLods][k_maxCircleSegments + 1];
+};
+
+static const UnitCircle s_unitCircle;
+
+int Renderer::CircleSegments(float radiusInPixels)
+{
+	// Keep the chord error r * (1 - cos(pi / n)) under half a pixel,
+	// i.e. n > pi * sqrt(r).
+	float needed = (float)k_pi * sqrtf(radiusInPixels > 0.0f ? radiusInPixels : 0.0f);
+	int n = k_minCircleSegments;
+	while (n < k_maxCircleSegments && (float)n < needed)
+		n <<= 1;
+	return n;
+}
+
+static RenderVertex Color(float r, float g, float b)
+{
+	RenderVertex v;
+	v.r = (unsigned char)(r * 255.0f);
+	v.g = (unsigned char)(g * 255.0f);
+	v.b = (unsigned char)(b * 255.0f);
+	v.a = 255;
+	v.x = 0.0f;
+	v.y = 0.0f;
+	return v;
+}
+
+void Renderer::Begin()
+{
+	fills.clear();
+	lines.clear();
+	circles.clear();
+}
+
+void Renderer::Fill(const Vec2& v, const RenderVertex& color)
+{
+	RenderVertex rv = color;
+	rv.x = (float)v.x;
+	rv.y = (float)v.y;
+	fills.push_back(rv);
+}
+
+void Renderer::Line(const Vec2& a, const Vec2& b, const RenderVertex& color)
+{
+	RenderVertex rv = color;
+	rv.x = (float)a.x;
+	rv.y = (float)a.y;
+	lines.push_back(rv);
+	rv.x = (float)b.x;
+	rv.y = (float)b.y;
+	lines.push_back(rv);
+}
+
+void Renderer::AddBody(const Body* body)
+{
+	Mat22 R(body->rotation);
+	Vec2 x = body->position;
+	Vec2 h = 0.5f * body->width;
+	float r = (float)body->radius;
+	RenderVertex outline = Color(0.0f, 0.0f, 0.0f);
+
+	switch (body->shape)
+	{
+	case BOX:
+	{
+		RenderVertex color = body->canDrag ? Color(0.5f, 0.5f, 1.0f) : Color(1.0f, 1.0f, 1.0f);
+		Vec2 v[4] = {Vec2(-h.x, -h.y), Vec2(h.x, -h.y), Vec2(h.x, h.y), Vec2(-h.x, h.y)};
+		TransformPoints(v, v, 4, R, x);
+		const Vec2& v1 = v[0];
+		const Vec2& v2 = v[1];
+		const Vec2& v3 = v[2];
+		const Vec2& v4 = v[3];
+
+		Fill(v1, color); Fill(v2, color); Fill(v3, color);
+		Fill(v1, color); Fill(v3, color); Fill(v4, color);
+
+		Line(v1, v2, outline);
+		Line(v2, v3, outline);
+		Line(v3, v4, outline);
+	}
+	break;
+
+	case CIRCLE:
+		AddCircle(x, r, body->canDrag ? Color(1.0f, 1.0f, 0.5f) : Color(1.0f, 1.0f, 1.0f));
+		break;
+
+	case TRIANGLE:
+	{
+		RenderVertex color = body->canDrag ? Color(0.5f, 1.0f, 1.0f) : Color(1.0f, 1.0f, 1.0f);
+		Vec2 v[3] = {Vec2(-h.x, -h.y), Vec2(h.x, -h.y), Vec2(0.0f, h.y)};
+		TransformPoints(v, v, 3, R, x);
+		const Vec2& v1 = v[0];
+		const Vec2& v2 = v[1];
+		const Vec2& v3 = v[2];
+
+		Fill(v1, color); Fill(v2, color); Fill(v3, color);
+
+		Line(v1, v2, outline);
+		Line(v2, v3, outline);
+	}
+	break;
+	}
+}
+
+void Renderer::AddCircle(const Vec2& center, float radius, const RenderVertex& color)
+{
+	CircleInstance c;
+	c.center = center;
+	c.radius = radius;
+	c.color = color;
+	circles.push_back(c);
+}
+
+void Renderer::ExpandCircles()
+{
+	RenderVertex outline = Color(0.0f, 0.0f, 0.0f);
+
+	for (int i = 0; i < (int)circles.size(); ++i)
+	{
+		const CircleInstance& c = circles[i];
+		int n = CircleSegments(c.radius * pixelsPerUnit);
+
+		int lod = 0;
+		while ((k_minCircleSegments << lod) < n)
+			++lod;
+		const Vec2* unit = s_unitCircle.table[lod];
+
+		for (int k = 0; k < n; ++k)
+		{
+			Vec2 v1 = c.center + c.radius * unit[k];
+			Vec2 v2 = c.center + c.radius * unit[k + 1];
+			Fill(c.center, c.color); Fill(v1, c.color); Fill(v2, c.color);
+			Line(v1, v2, outline);
+		}
+	}
+}
+
+void Renderer::AddJoint(const Joint* joint)
+{
+	const Body* b1 = joint->body1;
+	const Body* b2 = joint->body2;
+
+	Mat22 R1(b1->rotation);
+	Mat22 R2(b2->rotation);
+
+	Vec2 x1 = b1->position;
+	Vec2 p1 = x1 + R1 * joint->localAnchor1;
+
+	Vec2 x2 = b2->position;
+	Vec2 p2 = x2 + R2 * joint->localAnchor2;
+
+	RenderVertex color = Color(0.5f, 0.5f, 0.8f);
+	Line(x1, p1, color);
+	Line(x2, p2, color);
+}
+
+void Renderer::Flush()
+{
+	ExpandCircles();
+
+	int numFills = (int)fills.size();
+	int numLines = (int)lines.size();
+	if (numFills + numLines == 0)
+		return;
+
+	// Fills and outlines share one interleaved array so the driver sees a
+	// single upload per frame.
+	buffer.resize(numFills + numLines);
+	if (numFills > 0)
+		memcpy(&buffer[0], &fills[0], numFills * sizeof(RenderVertex));
+	if (numLines > 0)
+		memcpy(&buffer[numFills], &lines[0], numLines * sizeof(RenderVertex));
+
+	glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+	glInterleavedArrays(GL_C4UB_V2F, 0, &buffer[0]);
+
+	if (numFills > 0)
+		glDrawArrays(GL_TRIANGLES, 0, numFills);
+	if (numLines > 0)
+		glDrawArrays(GL_LINES, numFills, numLines);
+
+	glPopClientAttrib();
+}
@@ -0,0 +1,65 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <vector>
+#include "MathUtils.h"
+
+struct Body;
+struct Joint;
+
+// Matches the GL_C4UB_V2F interleaved layout.
+struct RenderVertex
+{
+	unsigned char r, g, b, a;
+	float x, y;
+};
+
+struct CircleInstance
+{
+	Vec2 center;
+	float radius;
+	RenderVertex color;
+};
+
+// Collects every body and joint of a frame into one interleaved vertex
+// array, then draws all fills with one call and all outlines with another.
+struct Renderer
+{
+	Renderer() : pixelsPerUnit(40.0f) {}
+
+	void Begin();
+	void AddBody(const Body* body);
+	void AddJoint(const Joint* joint);
+	void AddCircle(const Vec2& center, float radius, const RenderVertex& color);
+	void Flush();
+
+	// Circles are tessellated from precomputed unit-circle tables; the
+	// segment count is picked from the on-screen radius.
+	void SetPixelsPerUnit(float ppu) { pixelsPerUnit = ppu; }
+	static int CircleSegments(float radiusInPixels);
+
+	std::vector<RenderVertex> fills;	// GL_TRIANGLES
+	std::vector<RenderVertex> lines;	// GL_LINES
+	std::vector<CircleInstance> circles;
+
+private:
+	void Fill(const Vec2& v, const RenderVertex& color);
+	void Line(const Vec2& a, const Vec2& b, const RenderVertex& color);
+	void ExpandCircles();
+
+	std::vector<RenderVertex> buffer;
+	float pixelsPerUnit;
+};
+
+#endif
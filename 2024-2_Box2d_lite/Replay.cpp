@@ -0,0 +1,95 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+#include "Replay.h"
+
+#include <stdio.h>
+
+void Replay::Clear()
+{
+	events.clear();
+	hashes.clear();
+}
+
+void Replay::Record(int type, int value, float x, float y)
+{
+	if (!recording)
+		return;
+
+	ReplayEvent e;
+	e.step = (int)hashes.size();
+	e.type = type;
+	e.value = value;
+	e.x = x;
+	e.y = y;
+	events.push_back(e);
+}
+
+void Replay::RecordStep(unsigned int hash)
+{
+	if (!recording)
+		return;
+
+	hashes.push_back(hash);
+}
+
+bool Replay::Save(const char* path) const
+{
+	FILE* fp = fopen(path, "wb");
+	if (fp == NULL)
+		return false;
+
+	ReplayHeader header;
+	header.magic = k_replayMagic;
+	header.version = k_replayVersion;
+	header.real = k_replayReal;
+	header.numEvents = (int)events.size();
+	header.numSteps = (int)hashes.size();
+
+	fwrite(&header, sizeof(ReplayHeader), 1, fp);
+	if (header.numEvents > 0)
+		fwrite(&events[0], sizeof(ReplayEvent), header.numEvents, fp);
+	if (header.numSteps > 0)
+		fwrite(&hashes[0], sizeof(unsigned int), header.numSteps, fp);
+
+	bool ok = ferror(fp) == 0;
+	fclose(fp);
+	return ok;
+}
+
+bool Replay::Load(const char* path)
+{
+	Clear();
+
+	FILE* fp = fopen(path, "rb");
+	if (fp == NULL)
+		return false;
+
+	ReplayHeader header;
+	bool ok = fread(&header, sizeof(ReplayHeader), 1, fp) == 1
+		&& header.magic == k_replayMagic && header.version == k_replayVersion && header.real == k_replayReal
+		&& header.numEvents >= 0 && header.numSteps >= 0;
+
+	if (ok)
+	{
+		events.resize(header.numEvents);
+		hashes.resize(header.numSteps);
+		if (header.numEvents > 0)
+			ok = fread(&events[0], sizeof(ReplayEvent), header.numEvents, fp) == (size_t)header.numEvents;
+		if (ok && header.numSteps > 0)
+			ok = fread(&hashes[0], sizeof(unsigned int), header.numSteps, fp) == (size_t)header.numSteps;
+	}
+
+	fclose(fp);
+	if (!ok)
+		Clear();
+	return ok;
+}
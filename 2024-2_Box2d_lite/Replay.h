@@ -0,0 +1,87 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <vector>
+
+// Replay stream layout:
+// ReplayHeader | ReplayEvent[numEvents] | unsigned int hashes[numSteps]
+// Bump the version with every change that makes recorded inputs produce
+// a different simulation: 2 for kinematic dragging, 3 for inv_dt from dt
+// and the per-World SolverConfig.
+const unsigned int k_replayMagic = 0x50525342;	// "BSRP"
+const int k_replayVersion = 3;
+
+// Scalar type of the build, see real in MathUtils.h. Replays only verify
+// against the build that recorded them.
+enum ReplayReal
+{
+	REPLAY_REAL_FLOAT,
+	REPLAY_REAL_DOUBLE,
+	REPLAY_REAL_FIXED
+};
+
+#if defined(BOX2D_FIXED)
+const int k_replayReal = REPLAY_REAL_FIXED;
+#elif defined(BOX2D_DOUBLE)
+const int k_replayReal = REPLAY_REAL_DOUBLE;
+#else
+const int k_replayReal = REPLAY_REAL_FLOAT;
+#endif
+
+enum ReplayEventType
+{
+	REPLAY_SCENE,		// value = scene index
+	REPLAY_RESTORE,		// value = scene index, restored from the round snapshot
+	REPLAY_GRAVITY,		// y = gravity
+	REPLAY_SELECT,		// value = body index, -1 to release
+	REPLAY_DRAG,		// x, y = target position of the selected body
+	REPLAY_UNDO
+};
+
+struct ReplayHeader
+{
+	unsigned int magic;
+	int version;
+	int real;
+	int numEvents;
+	int numSteps;
+};
+
+struct ReplayEvent
+{
+	int step;	// number of world steps taken before the event
+	int type;
+	int value;
+	float x, y;
+};
+
+struct Replay
+{
+	Replay() : recording(false) {}
+
+	void Clear();
+
+	// Events are stamped with the current step count.
+	void Record(int type, int value = 0, float x = 0.0f, float y = 0.0f);
+	void RecordStep(unsigned int hash);
+
+	bool Save(const char* path) const;
+	bool Load(const char* path);
+
+	std::vector<ReplayEvent> events;
+	std::vector<unsigned int> hashes;	// world state hash after each step
+	bool recording;
+};
+
+#endif
@@ -0,0 +1,254 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+#include "SceneFile.h"
+#include "Body.h"
+#include "Joint.h"
+#include "World.h"
+
+#include <stdio.h>
+#include <map>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+bool SaveScene(const char* path, const World& world)
+{
+	SceneHeader header;
+	header.magic = k_sceneMagic;
+	header.version = k_sceneVersion;
+	header.bodyRecordSize = sizeof(BodyRecord);
+	header.jointRecordSize = sizeof(JointRecord);
+	header.numBodies = (int)world.bodies.size();
+	header.numJoints = (int)world.joints.size();
+
+	std::map<const Body*, int> indices;
+	for (int i = 0; i < header.numBodies; ++i)
+		indices[world.bodies[i]] = i;
+
+	// Every joint must connect registered bodies, otherwise the file
+	// could not be loaded back.
+	for (int i = 0; i < header.numJoints; ++i)
+	{
+		const Joint* j = world.joints[i];
+		if (indices.find(j->body1) == indices.end() || indices.find(j->body2) == indices.end())
+			return false;
+	}
+
+	FILE* fp = fopen(path, "wb");
+	if (fp == NULL)
+		return false;
+
+	fwrite(&header, sizeof(SceneHeader), 1, fp);
+
+	for (int i = 0; i < header.numBodies; ++i)
+	{
+		const Body* b = world.bodies[i];
+
+		BodyRecord r;
+		r.position = b->position;
+		r.rotation = (float)b->rotation;
+		r.width = b->width;
+		r.mass = (float)b->mass;
+		r.friction = (float)b->friction;
+		r.shape = b->shape;
+		r.canDrag = b->canDrag ? 1 : 0;
+		r.isSensor = b->isSensor ? 1 : 0;
+		r.isBullet = b->isBullet ? 1 : 0;
+		r.categoryBits = b->categoryBits;
+		r.maskBits = b->maskBits;
+		r.groupIndex = b->groupIndex;
+		r.pad = 0;
+		fwrite(&r, sizeof(BodyRecord), 1, fp);
+	}
+
+	for (int i = 0; i < header.numJoints; ++i)
+	{
+		const Joint* j = world.joints[i];
+
+		JointRecord r;
+		r.body1 = indices.find(j->body1)->second;
+		r.body2 = indices.find(j->body2)->second;
+		r.localAnchor1 = j->localAnchor1;
+		r.localAnchor2 = j->localAnchor2;
+		r.biasFactor = (float)j->biasFactor;
+		r.softness = (float)j->softness;
+		fwrite(&r, sizeof(JointRecord), 1, fp);
+	}
+
+	bool ok = ferror(fp) == 0;
+	fclose(fp);
+	return ok;
+}
+
+static bool ValidateScene(SceneMapping& scene)
+{
+	if (scene.size < sizeof(SceneHeader))
+		return false;
+
+	const SceneHeader* header = (const SceneHeader*)scene.data;
+	if (header->magic != k_sceneMagic || header->version != k_sceneVersion)
+		return false;
+
+	if (header->bodyRecordSize != sizeof(BodyRecord) || header->jointRecordSize != sizeof(JointRecord))
+		return false;
+
+	if (header->numBodies < 0 || header->numJoints < 0)
+		return false;
+
+	size_t expected = sizeof(SceneHeader)
+		+ (size_t)header->numBodies * sizeof(BodyRecord)
+		+ (size_t)header->numJoints * sizeof(JointRecord);
+	if (scene.size < expected)
+		return false;
+
+	scene.header = header;
+	scene.bodies = (const BodyRecord*)(header + 1);
+	scene.joints = (const JointRecord*)(scene.bodies + header->numBodies);
+	return true;
+}
+
+#ifdef _WIN32
+
+bool MapScene(const char* path, SceneMapping& scene)
+{
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	HANDLE mapping = NULL;
+	void* data = NULL;
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping != NULL)
+		data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+	scene.file = file;
+	scene.mapping = mapping;
+	scene.data = data;
+	scene.size = data != NULL ? (size_t)size.QuadPart : 0;
+
+	if (data == NULL || !ValidateScene(scene))
+	{
+		UnmapScene(scene);
+		return false;
+	}
+	return true;
+}
+
+void UnmapScene(SceneMapping& scene)
+{
+	if (scene.data != NULL)
+		UnmapViewOfFile(scene.data);
+	if (scene.mapping != NULL)
+		CloseHandle((HANDLE)scene.mapping);
+	if (scene.file != NULL)
+		CloseHandle((HANDLE)scene.file);
+	scene = SceneMapping();
+}
+
+#else
+
+bool MapScene(const char* path, SceneMapping& scene)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	void* data = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_size > 0)
+		data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED)
+		return false;
+
+	scene.data = data;
+	scene.size = (size_t)st.st_size;
+
+	if (!ValidateScene(scene))
+	{
+		UnmapScene(scene);
+		return false;
+	}
+	return true;
+}
+
+void UnmapScene(SceneMapping& scene)
+{
+	if (scene.data != NULL)
+		munmap(scene.data, scene.size);
+	scene = SceneMapping();
+}
+
+#endif
+
+int BuildScene(const SceneMapping& scene, World& world)
+{
+	int numBodies = scene.header->numBodies;
+	int first = (int)world.bodies.size();
+
+	for (int i = 0; i < numBodies; ++i)
+	{
+		const BodyRecord& r = scene.bodies[i];
+		Body b;
+
+		switch (r.shape)
+		{
+		case CIRCLE:
+			b.CircleSet(r.width, r.mass);
+			break;
+		case TRIANGLE:
+			b.TriangleSet(r.width, r.mass);
+			break;
+		default:
+			b.BoxSet(r.width, r.mass);
+			break;
+		}
+
+		b.position = r.position;
+		b.rotation = r.rotation;
+		b.friction = r.friction;
+		b.canDrag = r.canDrag != 0;
+		b.isSensor = r.isSensor != 0;
+		b.isBullet = r.isBullet != 0;
+		b.categoryBits = r.categoryBits;
+		b.maskBits = r.maskBits;
+		b.groupIndex = r.groupIndex;
+		world.CreateBody(b);
+	}
+
+	for (int i = 0; i < scene.header->numJoints; ++i)
+	{
+		const JointRecord& r = scene.joints[i];
+		if (r.body1 < 0 || r.body1 >= numBodies || r.body2 < 0 || r.body2 >= numBodies)
+			continue;
+
+		Joint j;
+		j.body1 = world.bodies[first + r.body1];
+		j.body2 = world.bodies[first + r.body2];
+		j.localAnchor1 = r.localAnchor1;
+		j.localAnchor2 = r.localAnchor2;
+		j.biasFactor = r.biasFactor;
+		j.softness = r.softness;
+		world.CreateJoint(j);
+	}
+
+	return numBodies;
+}
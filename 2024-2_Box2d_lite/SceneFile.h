@@ -0,0 +1,100 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+#ifndef SCENEFILE_H
+#define SCENEFILE_H
+
+#include "MathUtils.h"
+
+struct Body;
+struct Joint;
+struct World;
+
+// Binary scene layout:
+// SceneHeader | BodyRecord[numBodies] | JointRecord[numJoints]
+// Records are stored in the engine's native float layout, so a mapped file
+// is used in place without parsing. Builds with a wider real convert on
+// load and save.
+const unsigned int k_sceneMagic = 0x4E435342;	// "BSCN"
+const int k_sceneVersion = 2;		// 2: sensor, bullet and filter fields
+
+struct SceneHeader
+{
+	unsigned int magic;
+	int version;
+	int bodyRecordSize;
+	int jointRecordSize;
+	int numBodies;
+	int numJoints;
+};
+
+struct RecordVec2
+{
+	RecordVec2() {}
+	RecordVec2(const Vec2& v) : x((float)v.x), y((float)v.y) {}
+	operator Vec2() const { return Vec2(x, y); }
+
+	float x, y;
+};
+
+struct BodyRecord
+{
+	RecordVec2 position;
+	float rotation;
+	RecordVec2 width;
+	float mass;
+	float friction;
+	int shape;
+	int canDrag;
+	int isSensor;
+	int isBullet;
+	unsigned short categoryBits;
+	unsigned short maskBits;
+	short groupIndex;
+	short pad;		// written as 0 so saved files are reproducible
+};
+
+struct JointRecord
+{
+	int body1, body2;	// indices into the body records
+	RecordVec2 localAnchor1, localAnchor2;
+	float biasFactor;
+	float softness;
+};
+
+struct SceneMapping
+{
+	SceneMapping() : header(0), bodies(0), joints(0), data(0), size(0), file(0), mapping(0) {}
+
+	const SceneHeader* header;
+	const BodyRecord* bodies;
+	const JointRecord* joints;
+
+	// Platform handles
+	void* data;
+	size_t size;
+	void* file;
+	void* mapping;
+};
+
+// Writes the bodies and joints registered with the world. Fails without
+// writing when a joint references a body the world does not hold.
+bool SaveScene(const char* path, const World& world);
+
+// Maps a scene file read-only. Fails on a bad magic, version or size.
+bool MapScene(const char* path, SceneMapping& scene);
+void UnmapScene(SceneMapping& scene);
+
+// Creates the mapped bodies and joints in the world's pools. Returns the
+// number of bodies created.
+int BuildScene(const SceneMapping& scene, World& world);
+
+#endif
@@ -0,0 +1,260 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+#include "SpatialGrid.h"
+#include "Body.h"
+
+#include <algorithm>
+
+static bool EntryLess(const SpatialGrid::Entry& a, const SpatialGrid::Entry& b)
+{
+	if (a.cell != b.cell)
+		return a.cell < b.cell;
+	return a.body < b.body;
+}
+
+void SpatialGrid::Clear()
+{
+	aabbs.clear();
+	entries.clear();
+}
+
+void SpatialGrid::Build(const std::vector<Body*>& bodies, real dt)
+{
+	int n = (int)bodies.size();
+	aabbs.resize(n);
+	entries.clear();
+
+	for (int i = 0; i < n; ++i)
+	{
+		bodies[i]->ComputeAABB(aabbs[i]);
+
+		if (dt > 0.0f)
+		{
+			real d = bodies[i]->MotionBound(dt);
+			aabbs[i].lowerBound -= Vec2(d, d);
+			aabbs[i].upperBound += Vec2(d, d);
+		}
+
+		if (i == 0)
+		{
+			bounds = aabbs[i];
+		}
+		else
+		{
+			bounds.lowerBound.Set(Min(bounds.lowerBound.x, aabbs[i].lowerBound.x), Min(bounds.lowerBound.y, aabbs[i].lowerBound.y));
+			bounds.upperBound.Set(Max(bounds.upperBound.x, aabbs[i].upperBound.x), Max(bounds.upperBound.y, aabbs[i].upperBound.y));
+		}
+
+		int x0 = CellCoord(aabbs[i].lowerBound.x), x1 = CellCoord(aabbs[i].upperBound.x);
+		int y0 = CellCoord(aabbs[i].lowerBound.y), y1 = CellCoord(aabbs[i].upperBound.y);
+
+		for (int y = y0; y <= y1; ++y)
+		{
+			for (int x = x0; x <= x1; ++x)
+			{
+				Entry e;
+				e.cell = CellKey(x, y);
+				e.body = i;
+				entries.push_back(e);
+			}
+		}
+	}
+
+	std::sort(entries.begin(), entries.end(), EntryLess);
+}
+
+void SpatialGrid::FindPairs(std::vector<GridPair>& pairs) const
+{
+	pairs.clear();
+
+	int count = (int)entries.size();
+	int begin = 0;
+	while (begin < count)
+	{
+		long long cell = entries[begin].cell;
+		int end = begin + 1;
+		while (end < count && entries[end].cell == cell)
+			++end;
+
+		for (int i = begin; i < end; ++i)
+		{
+			int a = entries[i].body;
+			for (int j = i + 1; j < end; ++j)
+			{
+				int b = entries[j].body;
+				if (!Overlap(aabbs[a], aabbs[b]))
+					continue;
+
+				// Report the pair only from the cell holding the lower corner
+				// of the overlap, so pairs sharing several cells appear once.
+				int x = CellCoord(Max(aabbs[a].lowerBound.x, aabbs[b].lowerBound.x));
+				int y = CellCoord(Max(aabbs[a].lowerBound.y, aabbs[b].lowerBound.y));
+				if (CellKey(x, y) != cell)
+					continue;
+
+				GridPair pair;
+				pair.body1 = a;
+				pair.body2 = b;
+				pairs.push_back(pair);
+			}
+		}
+
+		begin = end;
+	}
+}
+
+void SpatialGrid::QueryPoint(const Vec2& p, GridPointCallback callback, void* context) const
+{
+	Entry key;
+	key.cell = CellKey(CellCoord(p.x), CellCoord(p.y));
+	key.body = -1;
+
+	std::vector<Entry>::const_iterator it = std::lower_bound(entries.begin(), entries.end(), key, EntryLess);
+	for (; it != entries.end() && it->cell == key.cell; ++it)
+	{
+		if (Contains(aabbs[it->body], p))
+			callback(context, it->body);
+	}
+}
+
+void SpatialGrid::RemoveProxy(int index, int last)
+{
+	// Renaming keeps entries grouped by cell, which is all the lookups need.
+	int n = 0;
+	for (int i = 0; i < (int)entries.size(); ++i)
+	{
+		Entry e = entries[i];
+		if (e.body == index)
+			continue;
+		if (e.body == last)
+			e.body = index;
+		entries[n++] = e;
+	}
+	entries.resize(n);
+
+	// Bodies added since the last Build have no proxy. Otherwise last is
+	// the final proxy, since World removes from the end of its list.
+	if (last < (int)aabbs.size())
+	{
+		aabbs[index] = aabbs[last];
+		aabbs.pop_back();
+	}
+}
+
+void SpatialGrid::QueryAABB(const AABB& aabb, std::vector<int>& results) const
+{
+	results.clear();
+
+	int x0 = CellCoord(aabb.lowerBound.x), x1 = CellCoord(aabb.upperBound.x);
+	int y0 = CellCoord(aabb.lowerBound.y), y1 = CellCoord(aabb.upperBound.y);
+
+	for (int y = y0; y <= y1; ++y)
+	{
+		for (int x = x0; x <= x1; ++x)
+		{
+			Entry key;
+			key.cell = CellKey(x, y);
+			key.body = -1;
+
+			std::vector<Entry>::const_iterator it = std::lower_bound(entries.begin(), entries.end(), key, EntryLess);
+			for (; it != entries.end() && it->cell == key.cell; ++it)
+			{
+				const AABB& b = aabbs[it->body];
+				if (!Overlap(b, aabb))
+					continue;
+
+				// Same once-only rule as FindPairs.
+				int cx = CellCoord(Max(b.lowerBound.x, aabb.lowerBound.x));
+				int cy = CellCoord(Max(b.lowerBound.y, aabb.lowerBound.y));
+				if (cx == x && cy == y)
+					results.push_back(it->body);
+			}
+		}
+	}
+}
+
+void SpatialGrid::RayCast(const Vec2& p1, const Vec2& p2, real maxFraction,
+						  GridRayCallback callback, void* context) const
+{
+	if (aabbs.empty())
+		return;
+
+	// Clip the segment to the occupied bounds so the cell walk stays short
+	// for rays that start or end far outside the scene.
+	Vec2 d = p2 - p1;
+	real tMin = 0.0f, tMax = maxFraction;
+	real p[2] = {p1.x, p1.y};
+	real dir[2] = {d.x, d.y};
+	real lower[2] = {bounds.lowerBound.x, bounds.lowerBound.y};
+	real upper[2] = {bounds.upperBound.x, bounds.upperBound.y};
+	for (int i = 0; i < 2; ++i)
+	{
+		if (dir[i] == 0.0f)
+		{
+			if (p[i] < lower[i] || p[i] > upper[i])
+				return;
+			continue;
+		}
+
+		real t1 = (lower[i] - p[i]) / dir[i];
+		real t2 = (upper[i] - p[i]) / dir[i];
+		if (t1 > t2)
+			Swap(t1, t2);
+		tMin = Max(tMin, t1);
+		tMax = Min(tMax, t2);
+		if (tMin > tMax)
+			return;
+	}
+
+	Vec2 start = p1 + tMin * d;
+	Vec2 end = p1 + tMax * d;
+	int x = CellCoord(start.x), y = CellCoord(start.y);
+	int ex = CellCoord(end.x), ey = CellCoord(end.y);
+
+	int stepX = d.x > 0.0f ? 1 : (d.x < 0.0f ? -1 : 0);
+	int stepY = d.y > 0.0f ? 1 : (d.y < 0.0f ? -1 : 0);
+	real tDeltaX = stepX != 0 ? cellSize / Abs(d.x) : FLT_MAX;
+	real tDeltaY = stepY != 0 ? cellSize / Abs(d.y) : FLT_MAX;
+	real tNextX = stepX != 0 ? ((x + (stepX > 0 ? 1 : 0)) * cellSize - p1.x) / d.x : FLT_MAX;
+	real tNextY = stepY != 0 ? ((y + (stepY > 0 ? 1 : 0)) * cellSize - p1.y) / d.y : FLT_MAX;
+
+	real tEntry = tMin;
+	// One spare cell absorbs rounding at cell borders.
+	int cells = 2 + abs(ex - x) + abs(ey - y);
+	for (int i = 0; i < cells && tEntry <= maxFraction; ++i)
+	{
+		Entry key;
+		key.cell = CellKey(x, y);
+		key.body = -1;
+
+		std::vector<Entry>::const_iterator it = std::lower_bound(entries.begin(), entries.end(), key, EntryLess);
+		for (; it != entries.end() && it->cell == key.cell; ++it)
+		{
+			maxFraction = callback(context, it->body, maxFraction);
+			if (maxFraction <= 0.0f)
+				return;
+		}
+
+		if (tNextX < tNextY)
+		{
+			tEntry = tNextX;
+			tNextX += tDeltaX;
+			x += stepX;
+		}
+		else
+		{
+			tEntry = tNextY;
+			tNextY += tDeltaY;
+			y += stepY;
+		}
+	}
+}
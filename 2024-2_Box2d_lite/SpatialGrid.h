@@ -0,0 +1,87 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+#include <vector>
+#include "MathUtils.h"
+
+struct Body;
+
+// Called for each grid entry crossed by a ray. Returns the new maximum
+// fraction: maxFraction to continue, a smaller value to clip the ray, 0 to
+// stop.
+typedef real (*GridRayCallback)(void* context, int body, real maxFraction);
+
+// Called for each body whose AABB contains the query point.
+typedef void (*GridPointCallback)(void* context, int body);
+
+struct GridPair
+{
+	int body1, body2;	// indices into World::bodies, body1 < body2
+};
+
+// Uniform grid broad-phase. Every body is binned into the cells its AABB
+// covers; the cell list is kept sorted so a cell is found by binary search.
+struct SpatialGrid
+{
+	SpatialGrid() : cellSize(2.0f) {}
+
+	void Clear();
+
+	// Rebuilds the cell lists from the current body positions. With dt > 0
+	// each AABB is extended by the distance the body can travel in dt.
+	void Build(const std::vector<Body*>& bodies, real dt = 0.0f);
+
+	// Pairs of bodies whose AABBs overlap, each reported once.
+	void FindPairs(std::vector<GridPair>& pairs) const;
+
+	// Visits the bodies whose AABB contains the point. Does not allocate.
+	void QueryPoint(const Vec2& p, GridPointCallback callback, void* context) const;
+
+	// Indices of bodies whose AABB overlaps the box, each reported once.
+	void QueryAABB(const AABB& aabb, std::vector<int>& results) const;
+
+	// Follows World's swap-remove: drops the proxy of body index and gives
+	// the proxy of body last, if it has one, the index. Linear in the
+	// number of entries, without a rebuild.
+	void RemoveProxy(int index, int last);
+
+	// Walks the cells crossed by p1 -> p2 in order along the segment. A body
+	// spanning several cells is visited once per cell.
+	void RayCast(const Vec2& p1, const Vec2& p2, real maxFraction,
+		GridRayCallback callback, void* context) const;
+
+	struct Entry
+	{
+		long long cell;
+		int body;
+	};
+
+	// Shifted as unsigned; left-shifting a negative x is undefined.
+	long long CellKey(int x, int y) const
+	{
+		return (long long)(((unsigned long long)(unsigned int)x << 32) | (unsigned int)y);
+	}
+
+	int CellCoord(real v) const
+	{
+		return (int)Clamp(Floor(v / cellSize), -1073741824.0f, 1073741824.0f);
+	}
+
+	std::vector<AABB> aabbs;		// indexed like World::bodies
+	std::vector<Entry> entries;		// sorted by cell, then body until RemoveProxy
+	AABB bounds;					// union of aabbs
+	real cellSize;
+};
+
+#endif
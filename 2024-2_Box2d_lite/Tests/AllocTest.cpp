@@ -0,0 +1,94 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+// After a warm-up, Step must not touch the heap: arbiters come from the
+// BlockAllocator, transient data from the FrameAllocator, and the World's
+// vectors keep their capacity. Contacts are churned by kicking a box
+// every step so arbiters keep being created and destroyed.
+
+#include <stdlib.h>
+#include <new>
+
+#include "TestCommon.h"
+
+static bool countNews = false;
+static int numNews = 0;
+
+void* operator new(size_t size)
+{
+	if (countNews)
+		++numNews;
+	void* p = malloc(size ? size : 1);
+	if (p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+int main()
+{
+	const real timeStep = 1.0f / 60.0f;
+
+	World world(Vec2(0.0f, -10.0f), 10);
+	BuildPyramid(world, 12);
+
+	// Circles as well, so every shape pair reaches the narrow phase.
+	for (int i = 0; i < 20; ++i)
+	{
+		Body ball;
+		ball.CircleSet(Vec2(0.8f, 0.8f), 5.0f);
+		ball.position.Set(-12.0f + 1.2f * i, 30.0f);
+		world.CreateBody(ball);
+	}
+
+	int numBodies = (int)world.bodies.size();
+	int kick = 0;
+	for (int i = 0; i < 600; ++i)
+	{
+		world.bodies[1 + kick++ % (numBodies - 1)]->velocity.y = 8.0f;
+		world.Step(timeStep);
+	}
+
+	int chunks = world.blockAllocator.GetChunkCount();
+	int capacity = world.frameAllocator.GetCapacity();
+	int highWater = world.frameAllocator.GetHighWaterMark();
+	int arbiterChanges = 0;
+
+	countNews = true;
+	for (int i = 0; i < 300; ++i)
+	{
+		int numArbiters = (int)world.arbiters.size();
+		world.bodies[1 + kick++ % (numBodies - 1)]->velocity.y = 8.0f;
+		world.Step(timeStep);
+		arbiterChanges += numArbiters != (int)world.arbiters.size();
+	}
+	countNews = false;
+
+	CHECK(arbiterChanges > 0);
+	CHECK(numNews == 0);
+	CHECK(world.blockAllocator.GetChunkCount() == chunks);
+	// An overflowing frame would have grown the buffer at the next Reset.
+	CHECK(world.frameAllocator.GetCapacity() == capacity);
+	CHECK(world.frameAllocator.GetHighWaterMark() == highWater);
+	CHECK(highWater <= capacity);
+
+	printf("new=%d chunks=%d frame capacity=%d high water=%d\n", numNews, chunks, capacity, highWater);
+	return TestResult("AllocTest");
+}
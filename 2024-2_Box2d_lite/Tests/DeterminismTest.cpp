@@ -0,0 +1,240 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+// Replays one recorded input stream three times and compares StateHash
+// after every step: twice from a fresh World, and once resumed from a
+// SaveState snapshot after the World was driven off course. Then steps a
+// set of worlds through WorldBatch on one thread and on several, which
+// must give the same hashes. Build with -DBOX2D_DETERMINISTIC as well to
+// cover the cross-platform mode.
+
+#include <vector>
+
+#include "TestCommon.h"
+#include "WorldBatch.h"
+
+enum
+{
+	k_numSteps = 600,
+	k_saveStep = 200,
+	k_detourSteps = 60,
+	k_batchWorlds = 16,
+	k_batchSteps = 300,
+	k_batchThreads = 4
+};
+
+// One step of input: a kick, a drag toward a target or a gravity flip.
+struct Input
+{
+	int type;
+	int body;
+	Vec2 value;
+};
+
+enum InputType
+{
+	INPUT_NONE,
+	INPUT_KICK,
+	INPUT_DRAG,
+	INPUT_RELEASE,
+	INPUT_GRAVITY
+};
+
+// Fixed LCG so the stream does not depend on the C library's rand.
+static unsigned int seed = 12345;
+
+static int NextInt(int n)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return (int)((seed >> 8) % (unsigned int)n);
+}
+
+static real NextReal(real lo, real hi)
+{
+	return lo + (hi - lo) * (real)NextInt(1 << 16) / (real)(1 << 16);
+}
+
+static void Record(std::vector<Input>& inputs, int numBodies)
+{
+	inputs.resize(k_numSteps);
+	int dragged = -1;
+	for (int i = 0; i < k_numSteps; ++i)
+	{
+		Input& in = inputs[i];
+		in.type = INPUT_NONE;
+		in.body = 1 + NextInt(numBodies - 1);
+		in.value.Set(NextReal(-8.0f, 8.0f), NextReal(0.0f, 10.0f));
+
+		int r = NextInt(20);
+		if (dragged >= 0)
+		{
+			in.body = dragged;
+			in.type = r < 2 ? INPUT_RELEASE : INPUT_DRAG;
+			if (in.type == INPUT_RELEASE)
+				dragged = -1;
+		}
+		else if (r < 3)
+			in.type = INPUT_KICK;
+		else if (r == 3)
+		{
+			in.type = INPUT_DRAG;
+			dragged = in.body;
+		}
+		else if (r == 4)
+			in.type = INPUT_GRAVITY;
+	}
+}
+
+static void Apply(World& world, const Input& in)
+{
+	Body* b = world.bodies[in.body];
+	switch (in.type)
+	{
+	case INPUT_KICK:
+		b->velocity = in.value;
+		break;
+	case INPUT_DRAG:
+		if (b->type != KINEMATIC_BODY)
+			b->SetKinematic(true);
+		b->SetTarget(in.value, b->rotation);
+		break;
+	case INPUT_RELEASE:
+		b->SetKinematic(false);
+		break;
+	case INPUT_GRAVITY:
+		world.gravity.y = world.gravity.y < 0.0f ? 0.0f : -10.0f;
+		break;
+	}
+}
+
+static void Run(const std::vector<Input>& inputs, std::vector<unsigned int>& hashes)
+{
+	World world(Vec2(0.0f, -10.0f), 10);
+	BuildPyramid(world, 10);
+
+	hashes.resize(k_numSteps);
+	for (int i = 0; i < k_numSteps; ++i)
+	{
+		Apply(world, inputs[i]);
+		world.Step(1.0f / 60.0f);
+		hashes[i] = world.StateHash();
+	}
+}
+
+// Gravity is not part of the snapshot, so it is saved beside it.
+static void RunRestored(const std::vector<Input>& inputs, std::vector<unsigned int>& hashes)
+{
+	World world(Vec2(0.0f, -10.0f), 10);
+	BuildPyramid(world, 10);
+
+	hashes.resize(k_numSteps);
+	std::vector<unsigned char> state;
+	Vec2 gravity;
+	for (int i = 0; i < k_saveStep; ++i)
+	{
+		Apply(world, inputs[i]);
+		world.Step(1.0f / 60.0f);
+		hashes[i] = world.StateHash();
+	}
+	world.SaveState(state);
+	gravity = world.gravity;
+
+	for (int i = 0; i < k_detourSteps; ++i)
+	{
+		Body* b = world.bodies[1 + i % ((int)world.bodies.size() - 1)];
+		b->velocity.Set(0.0f, 12.0f);
+		b->SetKinematic(i % 3 == 0);
+		world.gravity.y = (real)(i % 2) * -20.0f;
+		world.Step(1.0f / 60.0f);
+	}
+
+	CHECK(world.RestoreState(state));
+	world.gravity = gravity;
+
+	for (int i = k_saveStep; i < k_numSteps; ++i)
+	{
+		Apply(world, inputs[i]);
+		world.Step(1.0f / 60.0f);
+		hashes[i] = world.StateHash();
+	}
+}
+
+// Hashes of every batch world after every step, world-major. Each world
+// gets its own kick so the worlds differ.
+static void RunBatch(const SceneTemplate& scene, int numThreads, std::vector<unsigned int>& hashes)
+{
+	WorldBatch batch(numThreads);
+	batch.stopOnFall = false;
+	for (int i = 0; i < k_batchWorlds; ++i)
+	{
+		int index = batch.Add(&scene);
+		Body* bodies = batch.GetBodies(index);
+		bodies[1 + i % ((int)scene.bodies.size() - 1)].velocity.Set((real)(i - k_batchWorlds / 2), 6.0f);
+	}
+
+	hashes.resize(k_batchWorlds * k_batchSteps);
+	for (int step = 0; step < k_batchSteps; ++step)
+	{
+		batch.Step(1.0f / 60.0f, 1);
+		for (int i = 0; i < k_batchWorlds; ++i)
+			hashes[i * k_batchSteps + step] = batch.GetWorld(i).world.StateHash();
+	}
+}
+
+static int FirstMismatch(const std::vector<unsigned int>& a, const std::vector<unsigned int>& b)
+{
+	for (int i = 0; i < (int)a.size(); ++i)
+	{
+		if (a[i] != b[i])
+			return i;
+	}
+	return -1;
+}
+
+int main()
+{
+	std::vector<Input> inputs;
+	{
+		World world(Vec2(0.0f, -10.0f), 10);
+		BuildPyramid(world, 10);
+		Record(inputs, (int)world.bodies.size());
+	}
+
+	std::vector<unsigned int> first, second, restored;
+	Run(inputs, first);
+	Run(inputs, second);
+	RunRestored(inputs, restored);
+
+	CHECK(FirstMismatch(first, second) == -1);
+	CHECK(FirstMismatch(first, restored) == -1);
+
+	// The inputs must actually move things, or matching hashes prove nothing.
+	CHECK(first[k_saveStep] != first[k_numSteps - 1]);
+
+	SceneTemplate scene;
+	{
+		World world(Vec2(0.0f, -10.0f), 10);
+		BuildPyramid(world, 10);
+		scene.Set(world);
+	}
+
+	std::vector<unsigned int> single, threaded;
+	RunBatch(scene, 1, single);
+	RunBatch(scene, k_batchThreads, threaded);
+
+	CHECK(FirstMismatch(single, threaded) == -1);
+	CHECK(single[k_batchSteps - 1] != single[2 * k_batchSteps - 1]);
+
+	printf("final hash %08x, first mismatch %d (rerun) %d (restored) %d (%d threads)\n",
+		first[k_numSteps - 1], FirstMismatch(first, second), FirstMismatch(first, restored),
+		FirstMismatch(single, threaded), k_batchThreads);
+	return TestResult("DeterminismTest");
+}
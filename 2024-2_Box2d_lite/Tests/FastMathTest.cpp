@@ -0,0 +1,69 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+// SinCos, InvSqrt and Sqrt against double-precision libm, using the error
+// bounds documented in MathUtils.h. Build with -DBOX2D_FAST_MATH to test
+// the approximations; the default build checks libm against itself.
+// BOX2D_FAST_MATH is ignored outside float builds, so those skip it.
+
+#include <math.h>
+
+#include "TestCommon.h"
+
+#if defined(BOX2D_DOUBLE) || defined(BOX2D_FIXED)
+
+int main()
+{
+	printf("FastMathTest: skipped, real is not float\n");
+	return 0;
+}
+
+#else
+
+int main()
+{
+	// Absolute error over |angle| <= 1e4.
+	double sinCosError = 0.0;
+	for (int i = 0; i <= 2000000; ++i)
+	{
+		float angle = -1.0e4f + 2.0e4f * (float)i / 2000000.0f;
+		real s, c;
+		SinCos(angle, s, c);
+		sinCosError = fmax(sinCosError, fabs(s - sin((double)angle)));
+		sinCosError = fmax(sinCosError, fabs(c - cos((double)angle)));
+	}
+
+	// Relative error from FLT_MIN up to 2^126, stepping through mantissas.
+	double invSqrtError = 0.0, sqrtError = 0.0;
+	for (unsigned int bits = 0x00800000u; bits < 0x7f000000u; bits += 997)
+	{
+		union { float f; unsigned int i; } u;
+		u.i = bits;
+		double x = u.f;
+		invSqrtError = fmax(invSqrtError, fabs(InvSqrt(u.f) * sqrt(x) - 1.0));
+		sqrtError = fmax(sqrtError, fabs(Sqrt(u.f) / sqrt(x) - 1.0));
+	}
+
+	CHECK(sinCosError <= 1.2e-6);
+#if defined(BOX2D_FAST_RSQRT_SSE)
+	CHECK(invSqrtError <= 3.0e-7);
+	CHECK(sqrtError <= 3.0e-7);
+#else
+	CHECK(invSqrtError <= 5.0e-6);
+	CHECK(sqrtError <= 5.0e-6);
+#endif
+	CHECK(Sqrt(0.0f) == 0.0f);
+
+	printf("SinCos %.3g, InvSqrt %.3g, Sqrt %.3g\n", sinCosError, invSqrtError, sqrtError);
+	return TestResult("FastMathTest");
+}
+
+#endif
@@ -0,0 +1,94 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+// Fixed arithmetic saturates instead of wrapping, FixedSqrt is the exact
+// floor of the square root, and FixedSinCos stays within its documented
+// error. A few raw results are pinned so a change to the table or the
+// rounding shows up as a lockstep break. Fixed.cpp is always compiled,
+// so this test does not need BOX2D_FIXED.
+
+#include <math.h>
+
+#include "TestCommon.h"
+#include "Fixed.h"
+
+static const int k_max = 0x7FFFFFFF;
+
+int main()
+{
+	Fixed big = Fixed::FromRaw(k_max);
+	Fixed small = Fixed::FromRaw(-k_max);
+
+	// Saturation.
+	CHECK((big + Fixed(1)).raw == k_max);
+	CHECK((small - Fixed(1)).raw == -k_max);
+	CHECK((big * Fixed(2)).raw == k_max);
+	CHECK((big * Fixed(-2)).raw == -k_max);
+	CHECK((Fixed(30000) * Fixed(30000)).raw == k_max);
+	CHECK((Fixed(1) / Fixed(0)).raw == k_max);
+	CHECK((Fixed(-1) / Fixed(0)).raw == -k_max);
+	CHECK((Fixed(30000) / Fixed(0.001f)).raw == k_max);
+	CHECK((-small).raw == k_max);
+	CHECK(Fixed(FLT_MAX).raw == k_max);
+	CHECK(Fixed(-FLT_MAX).raw == -k_max);
+	CHECK(Fixed(100000).raw == k_max);
+	CHECK(Fixed(sqrt(-1.0)).raw == 0);
+
+	Fixed acc = big;
+	acc += big;
+	CHECK(acc.raw == k_max);
+	acc = small;
+	acc -= big;
+	CHECK(acc.raw == -k_max);
+
+	// Rounding: multiply rounds to nearest, divide and int truncate.
+	CHECK((Fixed::FromRaw(1) * Fixed(0.5f)).raw == 1);
+	CHECK((Fixed(1) / Fixed(3)).raw == 21845);
+	CHECK((Fixed(-1) / Fixed(3)).raw == -21845);
+	CHECK((int)Fixed(-2.5f) == -2);
+
+	// FixedSqrt is floor(sqrt(x)) to the last bit.
+	int sqrtErrors = 0;
+	for (int raw = 0; raw < k_max - 5000; raw += 4999)
+	{
+		Fixed q = FixedSqrt(Fixed::FromRaw(raw));
+		Fixed q1 = Fixed::FromRaw(q.raw + 1);
+		double x = (double)raw / Fixed::ONE;
+		if ((double)q * (double)q > x || (double)q1 * (double)q1 <= x)
+			++sqrtErrors;
+	}
+	CHECK(sqrtErrors == 0);
+	CHECK(FixedSqrt(Fixed(-4)).raw == 0);
+	CHECK(FixedSqrt(Fixed(4)).raw == 2 * Fixed::ONE);
+	CHECK(FixedSqrt(Fixed(2)).raw == 92681);
+
+	// FixedSinCos within 3e-5 over two turns each way.
+	double sinCosError = 0.0;
+	for (int i = -200000; i <= 200000; ++i)
+	{
+		Fixed angle = Fixed(i * (4.0 * 3.14159265358979 / 200000.0));
+		Fixed s, c;
+		FixedSinCos(angle, s, c);
+		double a = (double)angle;
+		sinCosError = fmax(sinCosError, fabs((double)s - sin(a)));
+		sinCosError = fmax(sinCosError, fabs((double)c - cos(a)));
+	}
+	CHECK(sinCosError <= 3.0e-5);
+
+	// sin(1) and cos(1) are 55146.64 and 35409.25 in units of 2^-16.
+	Fixed s, c;
+	FixedSinCos(Fixed(1), s, c);
+	CHECK(s.raw == 55146);
+	CHECK(c.raw == 35409);
+
+	printf("sin(1) raw %d, cos(1) raw %d, SinCos error %.3g\n", s.raw, c.raw, sinCosError);
+	return TestResult("FixedTest");
+}
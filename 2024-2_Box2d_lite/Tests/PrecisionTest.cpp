@@ -0,0 +1,82 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+// Runs the solver in whatever precision real was compiled with: the
+// default float build, -DBOX2D_DOUBLE or -DBOX2D_FIXED. A pyramid must
+// come to rest standing, and in the double build a slow box far from the
+// origin must cover the distance its velocity implies.
+
+#include <math.h>
+
+#include "TestCommon.h"
+
+static bool IsFinite(real x)
+{
+	double d = (double)x;
+	return d == d && fabs(d) < 1.0e6;
+}
+
+int main()
+{
+#if defined(BOX2D_DOUBLE)
+	CHECK(sizeof(real) == sizeof(double));
+	const char* name = "double";
+#elif defined(BOX2D_FIXED)
+	const char* name = "fixed";
+#else
+	CHECK(sizeof(real) == sizeof(float));
+	const char* name = "float";
+#endif
+
+	World world(Vec2(0.0f, -10.0f), 10);
+	BuildPyramid(world, 10);
+	Body* top = world.bodies.back();
+
+	for (int i = 0; i < 600; ++i)
+		world.Step(1.0f / 60.0f);
+
+	double maxSpeed = 0.0;
+	int finite = 1;
+	for (int i = 0; i < (int)world.bodies.size(); ++i)
+	{
+		Body* b = world.bodies[i];
+		finite &= IsFinite(b->position.x) && IsFinite(b->position.y) && IsFinite(b->rotation);
+		maxSpeed = fmax(maxSpeed, (double)b->velocity.Length());
+	}
+	// The rows start 1 m apart and settle onto each other.
+	double topError = fabs((double)top->position.y - 9.5);
+
+	CHECK(finite);
+	CHECK(maxSpeed < 0.05);
+	CHECK(topError < 0.1);
+
+	// 10 km from the origin a float step is about 1 mm, so a box falling
+	// with a sideways speed of 1 mm/s never leaves its starting x. Step
+	// zeroes velocities when gravity is off.
+	World far(Vec2(0.0f, -10.0f), 10);
+	const real farX = 10000.0f;
+	Body box;
+	box.BoxSet(Vec2(1.0f, 1.0f), 10.0f);
+	box.position.Set(farX, 0.0f);
+	box.velocity.Set(0.001f, 0.0f);
+	Body* b = far.GetBody(far.CreateBody(box));
+
+	for (int i = 0; i < 600; ++i)
+		far.Step(1.0f / 60.0f);
+
+	double moved = (double)(b->position.x - farX);
+#if defined(BOX2D_DOUBLE)
+	CHECK(fabs(moved - 0.01) < 1.0e-6);
+#endif
+
+	printf("%s: max speed %.3g, top error %.3g, moved %.6g of 0.01 m at %g m\n", name, maxSpeed, topError, moved, (double)farX);
+	return TestResult("PrecisionTest");
+}
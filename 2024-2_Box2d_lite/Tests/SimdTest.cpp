@@ -0,0 +1,68 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+// TransformPoints and DotPoints must match the scalar expressions bit for
+// bit, for every count so the remainder loops are covered, and in place.
+// Build with -DBOX2D_SIMD to test the SSE2 or NEON kernels; without it
+// the kernels are the scalar loops and the test is trivially true.
+
+#include "TestCommon.h"
+
+enum
+{
+	k_maxCount = 37
+};
+
+int main()
+{
+	srand(7);
+	int mismatches = 0;
+
+	for (int iter = 0; iter < 20000; ++iter)
+	{
+		int count = iter % (k_maxCount + 1);
+		Vec2 points[k_maxCount], out[k_maxCount];
+		real dots[k_maxCount];
+		for (int i = 0; i < count; ++i)
+			points[i].Set(Random(-1000.0f, 1000.0f), Random(-1000.0f, 1000.0f));
+
+		Mat22 R(Random(-10.0f, 10.0f));
+		Vec2 p(Random(-50.0f, 50.0f), Random(-50.0f, 50.0f));
+		Vec2 axis(Random(), Random());
+
+		TransformPoints(out, points, count, R, p);
+		DotPoints(dots, points, count, axis);
+		for (int i = 0; i < count; ++i)
+		{
+			Vec2 q = p + R * points[i];
+			if (out[i].x != q.x || out[i].y != q.y || dots[i] != Dot(points[i], axis))
+				++mismatches;
+		}
+
+		TransformPoints(points, points, count, R, p);
+		for (int i = 0; i < count; ++i)
+		{
+			if (points[i].x != out[i].x || points[i].y != out[i].y)
+				++mismatches;
+		}
+	}
+
+	CHECK(mismatches == 0);
+
+#if defined(BOX2D_SSE2)
+	printf("SSE2 kernels, %d mismatches\n", mismatches);
+#elif defined(BOX2D_NEON)
+	printf("NEON kernels, %d mismatches\n", mismatches);
+#else
+	printf("scalar kernels, %d mismatches\n", mismatches);
+#endif
+	return TestResult("SimdTest");
+}
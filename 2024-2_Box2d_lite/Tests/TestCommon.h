@@ -0,0 +1,62 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+#ifndef TESTCOMMON_H
+#define TESTCOMMON_H
+
+// Headless checks. Each .cpp in this directory is a standalone program
+// linked against the engine sources except main.cpp and Renderer.cpp,
+// e.g. from this directory:
+//   g++ -std=c++14 -O2 -I.. AllocTest.cpp $(ls ../*.cpp | grep -v "main\|Renderer") -lpthread
+// A test prints every failed check and returns nonzero if any failed.
+
+#include <stdio.h>
+
+#include "World.h"
+#include "Body.h"
+
+static int testFailures = 0;
+
+#define CHECK(cond) \
+	do { if (!(cond)) { printf("%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #cond); ++testFailures; } } while (0)
+
+inline int TestResult(const char* name)
+{
+	printf("%s: %s\n", name, testFailures ? "FAILED" : "passed");
+	return testFailures ? 1 : 0;
+}
+
+// Ground and a pyramid of boxes, the stacking scene of the original demos.
+inline void BuildPyramid(World& world, int rows)
+{
+	Body ground;
+	ground.BoxSet(Vec2(100.0f, 20.0f), FLT_MAX);
+	ground.position.Set(0.0f, -0.5f * 20.0f);
+	world.CreateBody(ground);
+
+	Vec2 x(-6.0f, 0.75f);
+	for (int i = 0; i < rows; ++i)
+	{
+		Vec2 y = x;
+		for (int j = i; j < rows; ++j)
+		{
+			Body box;
+			box.BoxSet(Vec2(1.0f, 1.0f), 10.0f);
+			box.friction = 0.2f;
+			box.position = y;
+			world.CreateBody(box);
+			y += Vec2(1.125f, 0.0f);
+		}
+		x += Vec2(0.5625f, 2.0f);
+	}
+}
+
+#endif
@@ -0,0 +1,155 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int numThreads) : task(0), context(0), generation(0), busy(0), quit(false)
+{
+	if (numThreads <= 0)
+		numThreads = (int)std::thread::hardware_concurrency();
+	if (numThreads <= 0)
+		numThreads = 1;
+
+	for (int i = 0; i < numThreads; ++i)
+	{
+		WorkRange* range = new WorkRange;
+		range->begin = 0;
+		range->end = 0;
+		ranges.push_back(range);
+	}
+
+	for (int i = 1; i < numThreads; ++i)
+		threads.push_back(std::thread(&ThreadPool::WorkerLoop, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	wake.notify_all();
+
+	for (int i = 0; i < (int)threads.size(); ++i)
+		threads[i].join();
+
+	for (int i = 0; i < (int)ranges.size(); ++i)
+		delete ranges[i];
+}
+
+void ThreadPool::ParallelFor(int count, TaskFn fn, void* ctx)
+{
+	if (count <= 0)
+		return;
+
+	int n = (int)ranges.size();
+	if (n == 1 || count == 1)
+	{
+		for (int i = 0; i < count; ++i)
+			fn(ctx, i);
+		return;
+	}
+
+	// Even split; stealing evens out uneven task cost.
+	for (int i = 0; i < n; ++i)
+	{
+		std::lock_guard<std::mutex> lock(ranges[i]->mutex);
+		ranges[i]->begin = (int)((long long)count * i / n);
+		ranges[i]->end = (int)((long long)count * (i + 1) / n);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		task = fn;
+		context = ctx;
+		busy = (int)threads.size();
+		++generation;
+	}
+	wake.notify_all();
+
+	RunTasks(0);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while (busy > 0)
+		done.wait(lock);
+}
+
+void ThreadPool::WorkerLoop(int self)
+{
+	int seen = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			while (!quit && generation == seen)
+				wake.wait(lock);
+			if (quit)
+				return;
+			seen = generation;
+		}
+
+		RunTasks(self);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--busy == 0)
+				done.notify_all();
+		}
+	}
+}
+
+void ThreadPool::RunTasks(int self)
+{
+	int index;
+	while (Pop(self, index) || Steal(self, index))
+		task(context, index);
+}
+
+bool ThreadPool::Pop(int self, int& index)
+{
+	WorkRange* range = ranges[self];
+	std::lock_guard<std::mutex> lock(range->mutex);
+	if (range->begin >= range->end)
+		return false;
+
+	index = range->begin++;
+	return true;
+}
+
+bool ThreadPool::Steal(int self, int& index)
+{
+	int n = (int)ranges.size();
+	for (int k = 1; k < n; ++k)
+	{
+		WorkRange* victim = ranges[(self + k) % n];
+		int begin, end;
+		{
+			std::lock_guard<std::mutex> lock(victim->mutex);
+			int size = victim->end - victim->begin;
+			if (size <= 0)
+				continue;
+
+			// Take the back half.
+			end = victim->end;
+			begin = end - (size + 1) / 2;
+			victim->end = begin;
+		}
+
+		index = begin;
+
+		WorkRange* range = ranges[self];
+		std::lock_guard<std::mutex> lock(range->mutex);
+		range->begin = begin + 1;
+		range->end = end;
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,64 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Fixed set of worker threads running index-based parallel loops. Each
+// worker owns a slice of the index range and steals half of a busy
+// worker's remaining slice when its own runs dry.
+struct ThreadPool
+{
+	typedef void (*TaskFn)(void* context, int index);
+
+	// numThreads counts the calling thread; 0 uses the hardware concurrency.
+	explicit ThreadPool(int numThreads = 0);
+	~ThreadPool();
+
+	// Runs task(context, i) for i in [0, count) and returns when all are done.
+	void ParallelFor(int count, TaskFn task, void* context);
+
+	int GetThreadCount() const { return (int)ranges.size(); }
+
+private:
+	ThreadPool(const ThreadPool&);
+	void operator = (const ThreadPool&);
+
+	struct WorkRange
+	{
+		std::mutex mutex;
+		int begin, end;
+	};
+
+	void WorkerLoop(int self);
+	void RunTasks(int self);
+	bool Pop(int self, int& index);
+	bool Steal(int self, int& index);
+
+	std::vector<std::thread> threads;
+	std::vector<WorkRange*> ranges;		// ranges[0] belongs to the calling thread
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	TaskFn task;
+	void* context;
+	int generation;
+	int busy;
+	bool quit;
+};
+
+#endif
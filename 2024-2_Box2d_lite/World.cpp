@@ -12,150 +12,1282 @@
 #include "World.h"
 #include "Body.h"
 #include "Joint.h"
+#include "ThreadPool.h"
 #include <iostream>
+#include <algorithm>
+#include <string.h>
 
 
 using std::map;
 using std::pair;
 using std::vector;
 
-typedef map<ArbiterKey, Arbiter>::iterator ArbIter;
+typedef ArbiterMap::iterator ArbIter;
 typedef pair<ArbiterKey, Arbiter> ArbPair;
 
-bool World::accumulateImpulses = true;
-bool World::warmStarting = true;
-bool World::positionCorrection = true;
 
+// Out of line so the pools are instantiated where Body and Joint are complete.
+// Listed in declaration order; arbiters uses blockAllocator, declared above it.
+World::World(Vec2 gravity, int iterations) :
+	arbiters(std::less<ArbiterKey>(), ArbiterMap::allocator_type(&blockAllocator)),
+	regionCallback(NULL), regionUserData(NULL),
+	contactCallback(NULL), contactUserData(NULL), nextBodyId(0),
+	gravity(gravity), iterations(iterations)
+{
+}
+
+World::~World()
+{
+}
 
 void World::Add(Body *body)
 {
+	body->id = nextBodyId++;
+	body->index = (int)bodies.size();
 	bodies.push_back(body);
+
+	body->contactList = NULL;
+	body->jointList = NULL;
+	body->solverIterations = 0;
+	body->regionMask = 0;
+	UpdateRegions(body, false);
 }
 
 void World::Add(Joint *joint)
 {
+	joint->index = (int)joints.size();
 	joints.push_back(joint);
+	joint->Link();
+}
+
+void World::Remove(Body* body)
+{
+	if (body->index < 0 || body->index >= (int)bodies.size() || bodies[body->index] != body)
+		return;
+
+	// Joints attached to the body go with it.
+	while (body->jointList)
+	{
+		// A copied def can carry a stale handle, so check it resolves to j.
+		Joint* j = body->jointList->joint;
+		if (jointPool.Get(j->handle) == j)
+			DestroyJoint(j->handle);
+		else
+			Remove(j);
+	}
+
+	// Only the body's own arbiters are visited. The other bodies keep
+	// their remaining contacts and warm-start impulses; there is no
+	// sleeping, so nothing needs to be woken.
+	while (body->contactList)
+	{
+		Arbiter* arb = body->contactList->arbiter;
+		ArbiterKey key(arb->body1, arb->body2);
+		arb->Unlink();
+		arbiters.erase(key);
+	}
+
+	for (int i = 0; i < (int)regions.size(); ++i)
+	{
+		if (body->regionMask & (1u << i))
+			--regions[i].count;
+	}
+	body->regionMask = 0;
+
+	// Drop queued events so the callbacks never see a removed body.
+	int n = 0;
+	for (int i = 0; i < (int)regionEvents.size(); ++i)
+	{
+		if (regionEvents[i].body != body)
+			regionEvents[n++] = regionEvents[i];
+	}
+	regionEvents.resize(n);
+
+	n = 0;
+	for (int i = 0; i < (int)contactEvents.size(); ++i)
+	{
+		if (contactEvents[i].body1 != body && contactEvents[i].body2 != body)
+			contactEvents[n++] = contactEvents[i];
+	}
+	contactEvents.resize(n);
+
+	// Swap with the last body. Ids are untouched, so arbiter keys and the
+	// solver order of the remaining bodies stay the same. The grid follows
+	// so queries keep finding the moved body.
+	grid.RemoveProxy(body->index, (int)bodies.size() - 1);
+	Body* last = bodies.back();
+	bodies[body->index] = last;
+	last->index = body->index;
+	bodies.pop_back();
+	body->index = -1;
+}
+
+void World::Remove(Joint* joint)
+{
+	if (joint->index < 0 || joint->index >= (int)joints.size() || joints[joint->index] != joint)
+		return;
+
+	joint->Unlink();
+
+	Joint* last = joints.back();
+	joints[joint->index] = last;
+	last->index = joint->index;
+	joints.pop_back();
+	joint->index = -1;
+}
+
+bool World::IsSupported(const Body* body, const Vec2& up, real minDot) const
+{
+	for (const ContactEdge* edge = body->contactList; edge; edge = edge->next)
+	{
+		const Arbiter* arb = edge->arbiter;
+		if (arb->sensor)
+			continue;
+
+		// Normals point from body1 to body2.
+		real sign = arb->body2 == body ? 1.0f : -1.0f;
+		for (int i = 0; i < arb->numContacts; ++i)
+		{
+			const Contact& c = arb->contacts[i];
+			if (c.separation <= 0.0f && sign * Dot(c.normal, up) >= minDot)
+				return true;
+		}
+	}
+	return false;
+}
+
+BodyHandle World::CreateBody(const Body& def)
+{
+	BodyHandle handle = bodyPool.Create(def);
+	Add(bodyPool.Get(handle));
+	return handle;
+}
+
+void World::DestroyBody(BodyHandle handle)
+{
+	Body* body = bodyPool.Get(handle);
+	if (body == NULL)
+		return;
+
+	Remove(body);
+	bodyPool.Destroy(handle);
+}
+
+Body* World::GetBody(BodyHandle handle) const
+{
+	return bodyPool.Get(handle);
+}
+
+JointHandle World::CreateJoint(const Joint& def)
+{
+	JointHandle handle = jointPool.Create(def);
+	Joint* joint = jointPool.Get(handle);
+	joint->handle = handle;
+	Add(joint);
+	return handle;
+}
+
+void World::DestroyJoint(JointHandle handle)
+{
+	Joint* joint = jointPool.Get(handle);
+	if (joint == NULL)
+		return;
+
+	Remove(joint);
+	jointPool.Destroy(handle);
+}
+
+Joint* World::GetJoint(JointHandle handle) const
+{
+	return jointPool.Get(handle);
 }
 
 void World::Clear()
 {
+	for (int i = 0; i < (int)bodies.size(); ++i)
+	{
+		bodies[i]->contactList = NULL;
+		bodies[i]->jointList = NULL;
+	}
+
 	bodies.clear();
 	joints.clear();
 	arbiters.clear();
+	grid.Clear();
+	bodyPool.Clear();
+	jointPool.Clear();
+	nextBodyId = 0;
+
+	for (int i = 0; i < (int)regions.size(); ++i)
+		regions[i].count = 0;
+	regionEvents.clear();
+	contactEvents.clear();
+}
+
+// Flat snapshot layout:
+// StateHeader | BodyState[numBodies] | Vec2[numJoints] | ArbiterState[numArbiters]
+struct StateHeader
+{
+	int numBodies;
+	int numJoints;
+	int numArbiters;
+};
+
+struct BodyState
+{
+	Vec2 position;
+	real rotation;
+	Vec2 velocity;
+	real angularVelocity;
+	Vec2 force;
+	real torque;
+	int solverIterations;
+	int type;
+	Vec2 targetPosition;
+	real targetRotation;
+};
+
+struct ArbiterState
+{
+	int body1, body2;	// indices into World::bodies
+	int numContacts;
+	Contact contacts[Arbiter::MAX_POINTS];
+};
+
+void World::SaveState(vector<unsigned char>& state) const
+{
+	StateHeader header;
+	header.numBodies = (int)bodies.size();
+	header.numJoints = (int)joints.size();
+	header.numArbiters = (int)arbiters.size();
+
+	state.resize(sizeof(StateHeader) + header.numBodies * sizeof(BodyState)
+		+ header.numJoints * sizeof(Vec2) + header.numArbiters * sizeof(ArbiterState));
+
+	unsigned char* p = &state[0];
+	memcpy(p, &header, sizeof(StateHeader));
+	p += sizeof(StateHeader);
+
+	for (int i = 0; i < header.numBodies; ++i)
+	{
+		const Body* b = bodies[i];
+
+		BodyState bs;
+		bs.position = b->position;
+		bs.rotation = b->rotation;
+		bs.velocity = b->velocity;
+		bs.angularVelocity = b->angularVelocity;
+		bs.force = b->force;
+		bs.torque = b->torque;
+		bs.solverIterations = b->solverIterations;
+		bs.type = b->type;
+		bs.targetPosition = b->targetPosition;
+		bs.targetRotation = b->targetRotation;
+		memcpy(p, &bs, sizeof(BodyState));
+		p += sizeof(BodyState);
+	}
+
+	for (int i = 0; i < header.numJoints; ++i)
+	{
+		memcpy(p, &joints[i]->P, sizeof(Vec2));
+		p += sizeof(Vec2);
+	}
+
+	for (ArbiterMap::const_iterator arb = arbiters.begin(); arb != arbiters.end(); ++arb)
+	{
+		ArbiterState as;
+		as.body1 = arb->second.body1->index;
+		as.body2 = arb->second.body2->index;
+		as.numContacts = arb->second.numContacts;
+		memcpy(as.contacts, arb->second.contacts, sizeof(as.contacts));
+		memcpy(p, &as, sizeof(ArbiterState));
+		p += sizeof(ArbiterState);
+	}
+}
+
+bool World::RestoreState(const vector<unsigned char>& state)
+{
+	if (state.size() < sizeof(StateHeader))
+		return false;
+
+	const unsigned char* p = &state[0];
+	StateHeader header;
+	memcpy(&header, p, sizeof(StateHeader));
+	p += sizeof(StateHeader);
+
+	if (header.numBodies != (int)bodies.size() || header.numJoints != (int)joints.size())
+		return false;
+
+	size_t expected = sizeof(StateHeader) + header.numBodies * sizeof(BodyState)
+		+ header.numJoints * sizeof(Vec2);
+	if (header.numArbiters < 0 || state.size() != expected + header.numArbiters * sizeof(ArbiterState))
+		return false;
+
+	// Validate every record before touching the world, so a bad snapshot
+	// leaves it unchanged. A repeated pair, in either order, would map to
+	// the same ArbiterKey and link one arbiter twice.
+	vector<pair<int, int> > pairKeys(header.numArbiters);
+	for (int i = 0; i < header.numArbiters; ++i)
+	{
+		ArbiterState as;
+		memcpy(&as, &state[expected + i * sizeof(ArbiterState)], sizeof(ArbiterState));
+		if (as.body1 < 0 || as.body1 >= header.numBodies || as.body2 < 0 || as.body2 >= header.numBodies
+			|| as.body1 == as.body2 || as.numContacts < 0 || as.numContacts > Arbiter::MAX_POINTS)
+			return false;
+
+		pairKeys[i] = pair<int, int>(std::min(as.body1, as.body2), std::max(as.body1, as.body2));
+	}
+	std::sort(pairKeys.begin(), pairKeys.end());
+	if (std::adjacent_find(pairKeys.begin(), pairKeys.end()) != pairKeys.end())
+		return false;
+
+	for (int i = 0; i < header.numBodies; ++i)
+	{
+		BodyState bs;
+		memcpy(&bs, p + i * sizeof(BodyState), sizeof(BodyState));
+		if (bs.type != STATIC_BODY && bs.type != DYNAMIC_BODY && bs.type != KINEMATIC_BODY)
+			return false;
+	}
+
+	for (int i = 0; i < header.numBodies; ++i)
+	{
+		Body* b = bodies[i];
+
+		BodyState bs;
+		memcpy(&bs, p, sizeof(BodyState));
+		p += sizeof(BodyState);
+
+		// Undoes a drag in progress, or resumes one.
+		if (b->type != bs.type)
+			b->SetKinematic(bs.type == KINEMATIC_BODY);
+		b->targetPosition = bs.targetPosition;
+		b->targetRotation = bs.targetRotation;
+
+		b->position = bs.position;
+		b->rotation = bs.rotation;
+		b->velocity = bs.velocity;
+		b->angularVelocity = bs.angularVelocity;
+		b->force = bs.force;
+		b->torque = bs.torque;
+		b->solverIterations = bs.solverIterations;
+	}
+
+	for (int i = 0; i < header.numJoints; ++i)
+	{
+		memcpy(&joints[i]->P, p, sizeof(Vec2));
+		p += sizeof(Vec2);
+	}
+
+	arbiters.clear();
+	for (int i = 0; i < header.numBodies; ++i)
+		bodies[i]->contactList = NULL;
+
+	for (int i = 0; i < header.numArbiters; ++i)
+	{
+		ArbiterState as;
+		memcpy(&as, p, sizeof(ArbiterState));
+		p += sizeof(ArbiterState);
+
+		Arbiter arb;
+		arb.body1 = bodies[as.body1];
+		arb.body2 = bodies[as.body2];
+		arb.friction = Sqrt(arb.body1->friction * arb.body2->friction);
+		arb.sensor = arb.body1->isSensor || arb.body2->isSensor;
+		arb.numContacts = as.numContacts;
+		memcpy(arb.contacts, as.contacts, sizeof(as.contacts));
+		pair<ArbIter, bool> inserted = arbiters.insert(ArbPair(ArbiterKey(arb.body1, arb.body2), arb));
+		if (inserted.second)
+			inserted.first->second.Link();
+	}
+
+	RefreshRegions();
+	return true;
+}
+
+static unsigned int HashBytes(unsigned int hash, const void* data, int size)
+{
+	const unsigned char* p = (const unsigned char*)data;
+	for (int i = 0; i < size; ++i)
+	{
+		hash ^= p[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+unsigned int World::StateHash() const
+{
+	unsigned int hash = 2166136261u;
+	for (int i = 0; i < (int)bodies.size(); ++i)
+	{
+		const Body* b = bodies[i];
+		hash = HashBytes(hash, &b->position, sizeof(Vec2));
+		hash = HashBytes(hash, &b->rotation, sizeof(real));
+		hash = HashBytes(hash, &b->velocity, sizeof(Vec2));
+		hash = HashBytes(hash, &b->angularVelocity, sizeof(real));
+	}
+	return hash;
+}
+
+
+void World::UpdateProxies()
+{
+	grid.Build(bodies);
+}
+
+struct PointQueryContext
+{
+	const World* world;
+	Vec2 point;
+	Body* result;
+};
+
+// Candidates arrive in cell order, so the result is picked by id.
+static void PointQueryCallback(void* context, int index)
+{
+	PointQueryContext* ctx = (PointQueryContext*)context;
+	Body* b = ctx->world->bodies[index];
+	if ((ctx->result == NULL || b->id < ctx->result->id) && b->TestPoint(ctx->point))
+		ctx->result = b;
+}
+
+Body* World::QueryPoint(const Vec2& point) const
+{
+	PointQueryContext ctx;
+	ctx.world = this;
+	ctx.point = point;
+	ctx.result = NULL;
+	grid.QueryPoint(point, PointQueryCallback, &ctx);
+	return ctx.result;
+}
+
+struct RayCastContext
+{
+	const World* world;
+	Vec2 p1, p2;
+	unsigned short maskBits;
+	RayCastHit* closest;			// single-hit query
+	vector<RayCastHit>* all;		// all-hits query
+};
+
+static real RayCastCallback(void* context, int index, real maxFraction)
+{
+	RayCastContext* ctx = (RayCastContext*)context;
+	if (index >= (int)ctx->world->bodies.size())
+		return maxFraction;
+
+	Body* b = ctx->world->bodies[index];
+	if ((b->categoryBits & ctx->maskBits) == 0)
+		return maxFraction;
+
+	ShapeProxy proxy;
+	proxy.Set(b);
+	Transform xf(b->position, b->rotation);
+
+	real fraction;
+	Vec2 normal;
+	if (!proxy.RayCast(xf, ctx->p1, ctx->p2, maxFraction, fraction, normal))
+		return maxFraction;
+
+	RayCastHit hit;
+	hit.body = b;
+	hit.point = ctx->p1 + fraction * (ctx->p2 - ctx->p1);
+	hit.normal = normal;
+	hit.fraction = fraction;
+
+	if (ctx->all)
+	{
+		ctx->all->push_back(hit);
+		return maxFraction;
+	}
+
+	// Equal fractions keep the lower id so the result does not depend on
+	// the order cells are visited.
+	if (ctx->closest->body == NULL || fraction < ctx->closest->fraction ||
+		(fraction == ctx->closest->fraction && b->id < ctx->closest->body->id))
+	{
+		*ctx->closest = hit;
+	}
+	return fraction;
+}
+
+static bool HitLess(const RayCastHit& a, const RayCastHit& b)
+{
+	if (a.fraction != b.fraction)
+		return a.fraction < b.fraction;
+	return a.body->id < b.body->id;
+}
+
+static bool HitBodyLess(const RayCastHit& a, const RayCastHit& b)
+{
+	if (a.body->id != b.body->id)
+		return a.body->id < b.body->id;
+	return a.fraction < b.fraction;
+}
+
+static bool SameBody(const RayCastHit& a, const RayCastHit& b)
+{
+	return a.body == b.body;
+}
+
+bool World::RayCast(const Vec2& p1, const Vec2& p2, RayCastHit& hit, unsigned short maskBits) const
+{
+	hit.body = NULL;
+
+	RayCastContext ctx;
+	ctx.world = this;
+	ctx.p1 = p1;
+	ctx.p2 = p2;
+	ctx.maskBits = maskBits;
+	ctx.closest = &hit;
+	ctx.all = NULL;
+	grid.RayCast(p1, p2, 1.0f, RayCastCallback, &ctx);
+
+	return hit.body != NULL;
+}
+
+void World::RayCastAll(const Vec2& p1, const Vec2& p2, vector<RayCastHit>& hits, unsigned short maskBits) const
+{
+	hits.clear();
+
+	RayCastContext ctx;
+	ctx.world = this;
+	ctx.p1 = p1;
+	ctx.p2 = p2;
+	ctx.maskBits = maskBits;
+	ctx.closest = NULL;
+	ctx.all = &hits;
+	grid.RayCast(p1, p2, 1.0f, RayCastCallback, &ctx);
+
+	// Bodies spanning several cells were hit once per cell.
+	std::sort(hits.begin(), hits.end(), HitBodyLess);
+	hits.erase(std::unique(hits.begin(), hits.end(), SameBody), hits.end());
+	std::sort(hits.begin(), hits.end(), HitLess);
+}
+
+static void ShapeCastCandidates(const SpatialGrid& grid, const ShapeCastInput& input, vector<int>& candidates)
+{
+	Transform xf(input.start, input.rotation);
+	const ShapeProxy& shape = input.shape;
+
+	AABB box;
+	box.lowerBound = box.upperBound = xf.Apply(shape.vertices[0]);
+	for (int i = 1; i < shape.count; ++i)
+	{
+		Vec2 v = xf.Apply(shape.vertices[i]);
+		box.lowerBound.Set(Min(box.lowerBound.x, v.x), Min(box.lowerBound.y, v.y));
+		box.upperBound.Set(Max(box.upperBound.x, v.x), Max(box.upperBound.y, v.y));
+	}
+
+	Vec2 r(shape.radius, shape.radius);
+	Vec2 t = input.translation;
+	AABB swept;
+	swept.lowerBound = box.lowerBound - r + Vec2(Min(t.x, 0.0f), Min(t.y, 0.0f));
+	swept.upperBound = box.upperBound + r + Vec2(Max(t.x, 0.0f), Max(t.y, 0.0f));
+
+	grid.QueryAABB(swept, candidates);
+}
+
+static bool ShapeCastBody(const ShapeCastInput& input, Body* b, RayCastHit& hit)
+{
+	ShapeProxy proxy;
+	proxy.Set(b);
+
+	Transform xfA(input.start, input.rotation);
+	Transform xfB(b->position, b->rotation);
+
+	if (!::ShapeCast(input.shape, xfA, input.translation, proxy, xfB, hit.fraction, hit.point, hit.normal))
+		return false;
+
+	hit.body = b;
+	return true;
+}
+
+bool World::ShapeCast(const ShapeCastInput& input, RayCastHit& hit, unsigned short maskBits) const
+{
+	hit.body = NULL;
+
+	vector<int> candidates;
+	ShapeCastCandidates(grid, input, candidates);
+
+	for (int i = 0; i < (int)candidates.size(); ++i)
+	{
+		if (candidates[i] >= (int)bodies.size())
+			continue;
+
+		Body* b = bodies[candidates[i]];
+		if ((b->categoryBits & maskBits) == 0)
+			continue;
+
+		RayCastHit h;
+		if (ShapeCastBody(input, b, h) && (hit.body == NULL || HitLess(h, hit)))
+			hit = h;
+	}
+
+	return hit.body != NULL;
+}
+
+void World::ShapeCastAll(const ShapeCastInput& input, vector<RayCastHit>& hits, unsigned short maskBits) const
+{
+	hits.clear();
+
+	vector<int> candidates;
+	ShapeCastCandidates(grid, input, candidates);
+
+	for (int i = 0; i < (int)candidates.size(); ++i)
+	{
+		if (candidates[i] >= (int)bodies.size())
+			continue;
+
+		Body* b = bodies[candidates[i]];
+		if ((b->categoryBits & maskBits) == 0)
+			continue;
+
+		RayCastHit h;
+		if (ShapeCastBody(input, b, h))
+			hits.push_back(h);
+	}
+
+	std::sort(hits.begin(), hits.end(), HitLess);
+}
+
+// Batch queries run in chunks so the pool's per-task cost is amortized.
+const int k_castsPerTask = 64;
+
+struct CastBatch
+{
+	const World* world;
+	const RayInput* rays;
+	const ShapeCastInput* shapes;
+	RayCastHit* hits;
+	int count;
+	unsigned short maskBits;
+};
+
+static void CastBatchTask(void* context, int index)
+{
+	CastBatch* batch = (CastBatch*)context;
+	int begin = index * k_castsPerTask;
+	int end = std::min(begin + k_castsPerTask, batch->count);
+
+	for (int i = begin; i < end; ++i)
+	{
+		if (batch->rays)
+			batch->world->RayCast(batch->rays[i].p1, batch->rays[i].p2, batch->hits[i], batch->maskBits);
+		else
+			batch->world->ShapeCast(batch->shapes[i], batch->hits[i], batch->maskBits);
+	}
 }
 
+void World::RayCastBatch(const RayInput* rays, int count, RayCastHit* hits, ThreadPool& pool, unsigned short maskBits) const
+{
+	CastBatch batch;
+	batch.world = this;
+	batch.rays = rays;
+	batch.shapes = NULL;
+	batch.hits = hits;
+	batch.count = count;
+	batch.maskBits = maskBits;
+	pool.ParallelFor((count + k_castsPerTask - 1) / k_castsPerTask, CastBatchTask, &batch);
+}
 
-void World::BroadPhase()
+void World::ShapeCastBatch(const ShapeCastInput* inputs, int count, RayCastHit* hits, ThreadPool& pool, unsigned short maskBits) const
 {
-	// O(n^2) broad-phase
+	CastBatch batch;
+	batch.world = this;
+	batch.rays = NULL;
+	batch.shapes = inputs;
+	batch.hits = hits;
+	batch.count = count;
+	batch.maskBits = maskBits;
+	pool.ParallelFor((count + k_castsPerTask - 1) / k_castsPerTask, CastBatchTask, &batch);
+}
+
+int World::AddRegion(const AABB& bounds)
+{
+	if ((int)regions.size() >= MAX_REGIONS)
+		return -1;
+
+	Region region;
+	region.bounds = bounds;
+	region.count = 0;
+	regions.push_back(region);
+
+	RefreshRegions();
+	return (int)regions.size() - 1;
+}
+
+void World::ClearRegions()
+{
+	regions.clear();
+	regionEvents.clear();
+
+	for (int i = 0; i < (int)bodies.size(); ++i)
+		bodies[i]->regionMask = 0;
+}
+
+void World::SetRegionCallback(RegionCallback callback, void* userData)
+{
+	regionCallback = callback;
+	regionUserData = userData;
+}
+
+void World::RefreshRegions()
+{
+	for (int i = 0; i < (int)regions.size(); ++i)
+		regions[i].count = 0;
+
 	for (int i = 0; i < (int)bodies.size(); ++i)
 	{
-		Body *bi = bodies[i];
+		bodies[i]->regionMask = 0;
+		UpdateRegions(bodies[i], false);
+	}
+}
+
+void World::UpdateRegions(Body* body, bool report)
+{
+	for (int i = 0; i < (int)regions.size(); ++i)
+	{
+		unsigned int bit = 1u << i;
+		bool inside = Contains(regions[i].bounds, body->position);
+		bool wasInside = (body->regionMask & bit) != 0;
+		if (inside == wasInside)
+			continue;
 
-		for (int j = i + 1; j < (int)bodies.size(); ++j)
+		if (inside)
 		{
-			Body *bj = bodies[j];
+			body->regionMask |= bit;
+			++regions[i].count;
+		}
+		else
+		{
+			body->regionMask &= ~bit;
+			--regions[i].count;
+		}
 
-			if (bi->invMass == 0.0f && bj->invMass == 0.0f)
-				continue;
+		if (report)
+		{
+			RegionEvent e;
+			e.type = inside ? REGION_ENTER : REGION_EXIT;
+			e.region = i;
+			e.body = body;
+			regionEvents.push_back(e);
+		}
+	}
+}
+
+void World::BroadPhase(real dt)
+{
+	// Grid broad-phase. Speculative contacts need pairs that may touch
+	// within the step, so the proxies are extended by the motion bound.
+	real speculativeDt = config.speculativeContacts ? dt : 0.0f;
+	grid.Build(bodies, speculativeDt);
+	grid.FindPairs(pairs);
+
+	stats = WorldStats();
+	stats.candidatePairs = (int)pairs.size();
+
+	for (int i = 0; i < (int)pairs.size(); ++i)
+	{
+		Body *bi = bodies[pairs[i].body1];
+		Body *bj = bodies[pairs[i].body2];
+
+		if (bi->invMass == 0.0f && bj->invMass == 0.0f)
+			continue;
+
+		if (!ShouldCollide(bi, bj))
+		{
+			++stats.filteredPairs;
+			continue;
+		}
 
-			Arbiter newArb(bi, bj);
-			ArbiterKey key(bi, bj);
+		++stats.narrowPhasePairs;
+		real margin = bi->MotionBound(speculativeDt) + bj->MotionBound(speculativeDt);
+		Arbiter newArb(bi, bj, margin);
+		ArbiterKey key(bi, bj);
 
-			if (newArb.numContacts > 0)
+		if (newArb.numContacts > 0)
+		{
+			ArbIter iter = arbiters.find(key);
+			if (iter == arbiters.end())
 			{
-				ArbIter iter = arbiters.find(key);
-				if (iter == arbiters.end())
-				{
-					arbiters.insert(ArbPair(key, newArb));
-				}
-				else
-				{
-					iter->second.Update(newArb.contacts, newArb.numContacts);
-				}
+				arbiters.insert(ArbPair(key, newArb)).first->second.Link();
+				AddContactEvent(CONTACT_BEGIN, newArb.body1, newArb.body2);
 			}
 			else
 			{
-				arbiters.erase(key);
+				iter->second.Update(newArb.contacts, newArb.numContacts, config);
+			}
+		}
+		else
+		{
+			ArbIter iter = arbiters.find(key);
+			if (iter != arbiters.end())
+			{
+				iter->second.Unlink();
+				arbiters.erase(iter);
+				AddContactEvent(CONTACT_END, key.body1, key.body2);
 			}
 		}
 	}
+
+	// Pairs whose bounds no longer overlap, whose filter changed, or whose
+	// bodies both became immovable, e.g. a dragged body turned kinematic
+	// while touching the ground, were not visited above.
+	for (ArbIter arb = arbiters.begin(); arb != arbiters.end();)
+	{
+		Body* b1 = arb->second.body1;
+		Body* b2 = arb->second.body2;
+		if ((b1->invMass != 0.0f || b2->invMass != 0.0f)
+			&& Overlap(grid.aabbs[b1->index], grid.aabbs[b2->index]) && ShouldCollide(b1, b2))
+		{
+			++arb;
+		}
+		else
+		{
+			AddContactEvent(CONTACT_END, arb->second.body1, arb->second.body2);
+			arb->second.Unlink();
+			arbiters.erase(arb++);
+		}
+	}
 }
 
+void World::AddContactEvent(int type, Body* body1, Body* body2)
+{
+	if (contactCallback == NULL)
+		return;
+
+	ContactEvent e;
+	e.type = type;
+	e.body1 = body1;
+	e.body2 = body2;
+	contactEvents.push_back(e);
+}
 
-void World::Step(float dt, Body *selected = NULL)
+void World::SetContactCallback(ContactCallback callback, void* userData)
 {
+	contactCallback = callback;
+	contactUserData = userData;
+}
+
+
+void World::SolveTOI(Body* b, real dt)
+{
+	const int k_maxSubSteps = 4;
 
-	//중력 없을때 충격량도 없애는 
-	if ( gravity.y == 0.0f)
+	ShapeProxy proxy;
+	proxy.Set(b);
+
+	Vec2 p0 = b->position;
+	real a0 = b->rotation;
+	real remaining = dt;
+
+	for (int sub = 0; sub < k_maxSubSteps; ++sub)
 	{
-		for (int i = 0; i < (int)bodies.size(); ++i)
+		Vec2 p1 = p0 + remaining * b->velocity;
+		real a1 = a0 + remaining * b->angularVelocity;
+
+		// Swept bounds of the sub-step.
+		AABB box0, box1, swept;
+		b->position = p0;
+		b->rotation = a0;
+		b->ComputeAABB(box0);
+		b->position = p1;
+		b->rotation = a1;
+		b->ComputeAABB(box1);
+		swept.lowerBound.Set(Min(box0.lowerBound.x, box1.lowerBound.x), Min(box0.lowerBound.y, box1.lowerBound.y));
+		swept.upperBound.Set(Max(box0.upperBound.x, box1.upperBound.x), Max(box0.upperBound.y, box1.upperBound.y));
+
+		grid.QueryAABB(swept, toiCandidates);
+
+		Body* hitBody = NULL;
+		real minToi = 1.0f;
+		Vec2 hitNormal(0.0f, 0.0f);
+
+		for (int i = 0; i < (int)toiCandidates.size(); ++i)
 		{
-			Body *b = bodies[i];
+			Body* other = bodies[toiCandidates[i]];
+			if (other == b || other->isSensor || (other->isBullet && other->invMass != 0.0f) || !ShouldCollide(b, other))
+				continue;
+
+			ShapeProxy otherProxy;
+			otherProxy.Set(other);
+			Transform xf(other->position, other->rotation);
 
-			if (b->invMass == 0.0f || b == selected)
+			++stats.toiPairs;
+			real toi;
+			Vec2 normal;
+			if (!TimeOfImpact(proxy, p0, a0, p1, a1, otherProxy, xf, toi, normal))
 				continue;
 
+			if (toi < minToi || (toi == minToi && other->id < hitBody->id))
+			{
+				hitBody = other;
+				minToi = toi;
+				hitNormal = normal;
+			}
+		}
+
+		// b is left at p1, a1.
+		if (hitBody == NULL)
+			return;
+
+		++stats.toiHits;
+		p0 = p0 + minToi * (p1 - p0);
+		a0 = a0 + minToi * (a1 - a0);
+		b->position = p0;
+		b->rotation = a0;
+		remaining *= 1.0f - minToi;
+
+		// Inelastic impulse along the normal removes the closing velocity.
+		real vn = Dot(b->velocity - hitBody->velocity, hitNormal);
+		if (vn < 0.0f)
+		{
+			Vec2 P = (-vn / (b->invMass + hitBody->invMass)) * hitNormal;
+			b->velocity += b->invMass * P;
+			hitBody->velocity -= hitBody->invMass * P;
+		}
+	}
+}
+
+// Island of the constraint's dynamic body, -1 when both are immovable.
+template <typename T>
+static int IslandOf(const T* constraint, const int* islandIds)
+{
+	const Body* b = constraint->body1->invMass != 0.0f ? constraint->body1 : constraint->body2;
+	return b->invMass != 0.0f ? islandIds[b->index] : -1;
+}
+
+// Stable counting sort by island, so every island solves its constraints
+// in the same relative order as the non-adaptive solver. Island k owns
+// sorted[start[k], start[k + 1]).
+template <typename T>
+static void SortByIsland(T* const* items, int count, const int* islandIds, int numIslands,
+	int* start, T** sorted, FrameAllocator& allocator)
+{
+	int* cursor = allocator.Allocate<int>(numIslands);
+	memset(start, 0, (numIslands + 1) * sizeof(int));
+
+	for (int i = 0; i < count; ++i)
+	{
+		int island = IslandOf(items[i], islandIds);
+		if (island >= 0)
+			++start[island + 1];
+	}
+
+	for (int k = 0; k < numIslands; ++k)
+	{
+		start[k + 1] += start[k];
+		cursor[k] = start[k];
+	}
+
+	for (int i = 0; i < count; ++i)
+	{
+		int island = IslandOf(items[i], islandIds);
+		if (island >= 0)
+			sorted[cursor[island]++] = items[i];
+	}
+}
+
+// Velocity change since the snapshot; the angular part counts as the
+// speed it gives the body's farthest point.
+static real VelocityChange(const Body* b, const Vec2& velocity, real angularVelocity)
+{
+	real extent = b->shape == CIRCLE ? b->radius : (0.5f * b->width).Length();
+	return (b->velocity - velocity).Length() + Abs(b->angularVelocity - angularVelocity) * extent;
+}
+
+void World::SolveIslands(Arbiter** contacts, int numContacts, real inv_dt)
+{
+	int numBodies = (int)bodies.size();
+	int numJoints = (int)joints.size();
+
+	// Flood fill through non-sensor contacts and joints. Static and
+	// kinematic bodies do not join islands, so bodies resting on the same
+	// ground are solved separately. Members of an island are contiguous in
+	// islandBodies.
+	int* islandIds = frameAllocator.Allocate<int>(numBodies);
+	Body** islandBodies = frameAllocator.Allocate<Body*>(numBodies);
+	int* bodyStart = frameAllocator.Allocate<int>(numBodies + 1);
+	for (int i = 0; i < numBodies; ++i)
+		islandIds[i] = -1;
+
+	int numIslands = 0;
+	int numIslandBodies = 0;
+	for (int i = 0; i < numBodies; ++i)
+	{
+		Body* seed = bodies[i];
+		if (seed->invMass == 0.0f || islandIds[i] != -1)
+			continue;
+
+		bodyStart[numIslands] = numIslandBodies;
+		islandIds[i] = numIslands;
+		islandBodies[numIslandBodies++] = seed;
+
+		for (int head = bodyStart[numIslands]; head < numIslandBodies; ++head)
+		{
+			Body* b = islandBodies[head];
+
+			for (ContactEdge* edge = b->contactList; edge != NULL; edge = edge->next)
+			{
+				Body* other = edge->other;
+				if (edge->arbiter->sensor || other->invMass == 0.0f || islandIds[other->index] != -1)
+					continue;
+				islandIds[other->index] = numIslands;
+				islandBodies[numIslandBodies++] = other;
+			}
+
+			for (JointEdge* edge = b->jointList; edge != NULL; edge = edge->next)
+			{
+				Body* other = edge->other;
+				if (other->invMass == 0.0f || islandIds[other->index] != -1)
+					continue;
+				islandIds[other->index] = numIslands;
+				islandBodies[numIslandBodies++] = other;
+			}
+		}
+
+		++numIslands;
+	}
+	bodyStart[numIslands] = numIslandBodies;
+
+	// Velocities before each of the last two sweeps.
+	Vec2* lastVelocity = frameAllocator.Allocate<Vec2>(numIslandBodies);
+	real* lastAngularVelocity = frameAllocator.Allocate<real>(numIslandBodies);
+
+	int* contactStart = frameAllocator.Allocate<int>(numIslands + 1);
+	int* jointStart = frameAllocator.Allocate<int>(numIslands + 1);
+	Arbiter** islandContacts = frameAllocator.Allocate<Arbiter*>(numContacts);
+	Joint** islandJoints = frameAllocator.Allocate<Joint*>(numJoints);
+	SortByIsland(contacts, numContacts, islandIds, numIslands, contactStart, islandContacts, frameAllocator);
+	SortByIsland(numJoints > 0 ? &joints[0] : NULL, numJoints, islandIds, numIslands, jointStart, islandJoints, frameAllocator);
+
+	for (int k = 0; k < numIslands; ++k)
+	{
+		Arbiter** c = islandContacts + contactStart[k];
+		Joint** j = islandJoints + jointStart[k];
+		int nc = contactStart[k + 1] - contactStart[k];
+		int nj = jointStart[k + 1] - jointStart[k];
+		if (nc + nj == 0)
+			continue;
+
+		// Start from the most demanding member, so a body dropped on a
+		// tall stack does not lower the stack's count.
+		int count = 0;
+		for (int i = bodyStart[k]; i < bodyStart[k + 1]; ++i)
+			count = std::max(count, islandBodies[i]->solverIterations);
+		if (count == 0)
+			count = iterations;
+		count = std::max(config.minIterations, std::min(count, config.maxIterations));
+
+		for (int i = 0; i < nc; ++i)
+			c[i]->PreStep(inv_dt, config);
+
+		for (int i = 0; i < nj; ++i)
+			j[i]->PreStep(inv_dt, config);
+
+		real previousChange = 0.0f;
+		for (int n = 0; n < count; ++n)
+		{
+			if (n >= count - 2)
+			{
+				for (int i = bodyStart[k]; i < bodyStart[k + 1]; ++i)
+				{
+					if (n == count - 1)
+						previousChange += VelocityChange(islandBodies[i], lastVelocity[i], lastAngularVelocity[i]);
+					lastVelocity[i] = islandBodies[i]->velocity;
+					lastAngularVelocity[i] = islandBodies[i]->angularVelocity;
+				}
+			}
+
+			for (int i = 0; i < nc; ++i)
+				c[i]->ApplyImpulse(config);
+
+			for (int i = 0; i < nj; ++i)
+				j[i]->ApplyImpulse();
+		}
+
+		// The sweeps converge roughly geometrically, so the distance to the
+		// converged velocities is about the last change over 1 - rate, with
+		// the rate taken from the last two sweeps. A tall stack changes
+		// little per sweep but converges slowly, and creeps if cut short.
+		real lastChange = 0.0f;
+		real maxChange = 0.0f;
+		for (int i = bodyStart[k]; i < bodyStart[k + 1]; ++i)
+		{
+			real change = VelocityChange(islandBodies[i], lastVelocity[i], lastAngularVelocity[i]);
+			lastChange += change;
+			maxChange = Max(maxChange, change);
+		}
+		real rate = previousChange > 0.0f ? Min(lastChange / previousChange, 0.99f) : 0.0f;
+		real velocityError = maxChange / (1.0f - rate);
+
+		// Penetration is measured at the start of the step, so it lags one
+		// step behind.
+		real penetration = 0.0f;
+		for (int i = 0; i < nc; ++i)
+		{
+			for (int p = 0; p < c[i]->numContacts; ++p)
+				penetration = Max(penetration, -c[i]->contacts[p].separation - config.allowedPenetration);
+		}
+
+		if (stats.islands == 0 || count < stats.minIterations)
+			stats.minIterations = count;
+		stats.maxIterations = std::max(stats.maxIterations, count);
+		stats.constraintIterations += count * (nc + nj);
+		++stats.islands;
+
+		// Grow quickly when the island drifts, shrink one at a time once it
+		// is well inside the tolerances.
+		if (velocityError > config.velocityTolerance || penetration > config.penetrationTolerance)
+			count += std::max(1, count / 2);
+		else if (velocityError < 0.25f * config.velocityTolerance && penetration < 0.25f * config.penetrationTolerance)
+			count -= 1;
+		count = std::max(config.minIterations, std::min(count, config.maxIterations));
+
+		for (int i = bodyStart[k]; i < bodyStart[k + 1]; ++i)
+			islandBodies[i]->solverIterations = count;
+	}
+}
+
+void World::Step(real dt)
+{
+	// Step temporaries live in the frame allocator.
+	frameAllocator.Reset();
+
+	real inv_dt = dt > 0.0f ? 1.0f / dt : 0.0f;
+
+	for (int i = 0; i < (int)bodies.size(); ++i)
+	{
+		Body *b = bodies[i];
+
+		// Kinematic bodies head for their target pose within this step.
+		if (b->type == KINEMATIC_BODY)
+		{
+			b->velocity = inv_dt * (b->targetPosition - b->position);
+			b->angularVelocity = inv_dt * (b->targetRotation - b->rotation);
+			continue;
+		}
+
+		//중력 없을때 충격량도 없애는 
+		if (gravity.y == 0.0f && b->invMass != 0.0f)
+		{
 			b->velocity = b->force * 0;
 			b->angularVelocity = 0;
 		}
 	}
 
-	const float inv_dt = 60.0f; // fixedTimeStep의 역수
-
-	
-	BroadPhase();
+	BroadPhase(dt);
 
 	// Integrate forces.
 	for (int i = 0; i < (int)bodies.size(); ++i)
 	{
 		Body *b = bodies[i];
 
-		if (b->invMass == 0.0f || b == selected)
+		if (b->invMass == 0.0f)
 			continue;
 
 		b->velocity += dt * (gravity + b->invMass * b->force);
 		b->angularVelocity += dt * b->invI * b->torque;
 	}
 
-	// Perform pre-steps.
+	// Flat list of the arbiters to solve, in map order. Sensor pairs only
+	// report overlap.
+	Arbiter** contacts = frameAllocator.Allocate<Arbiter*>((int)arbiters.size());
+	int numContacts = 0;
 	for (ArbIter arb = arbiters.begin(); arb != arbiters.end(); ++arb)
 	{
-		arb->second.PreStep(inv_dt);
+		if (!arb->second.sensor)
+			contacts[numContacts++] = &arb->second;
 	}
 
-	for (int i = 0; i < (int)joints.size(); ++i)
+	if (config.adaptiveIterations)
 	{
-		joints[i]->PreStep(inv_dt);
+		SolveIslands(contacts, numContacts, inv_dt);
 	}
-
-	// Perform iterations
-	for (int i = 0; i < iterations; ++i)
+	else
 	{
-		for (ArbIter arb = arbiters.begin(); arb != arbiters.end(); ++arb)
+		// Perform pre-steps.
+		for (int i = 0; i < numContacts; ++i)
 		{
-			arb->second.ApplyImpulse();
+			contacts[i]->PreStep(inv_dt, config);
 		}
 
-		for (int j = 0; j < (int)joints.size(); ++j)
+		for (int i = 0; i < (int)joints.size(); ++i)
 		{
-			joints[j]->ApplyImpulse();
+			joints[i]->PreStep(inv_dt, config);
 		}
+
+		// Perform iterations
+		for (int i = 0; i < iterations; ++i)
+		{
+			for (int j = 0; j < numContacts; ++j)
+			{
+				contacts[j]->ApplyImpulse(config);
+			}
+
+			for (int j = 0; j < (int)joints.size(); ++j)
+			{
+				joints[j]->ApplyImpulse();
+			}
+		}
+
+		stats.constraintIterations = iterations * (numContacts + (int)joints.size());
 	}
 
-	// Integrate Velocities
+	// Integrate Velocities. Bullets move after everything else so they are
+	// swept against the final poses.
+	Body** bullets = frameAllocator.Allocate<Body*>((int)bodies.size());
+	int numBullets = 0;
 	for (int i = 0; i < (int)bodies.size(); ++i)
 	{
 		Body *b = bodies[i];
-		if (b == selected)
+
+		b->force.Set(0.0f, 0.0f);
+		b->torque = 0.0f;
+
+		if (b->isBullet && b->invMass != 0.0f && !b->isSensor)
+		{
+			bullets[numBullets++] = b;
 			continue;
+		}
+
 		b->position += dt * b->velocity;
 		b->rotation += dt * b->angularVelocity;
 
+		if (!regions.empty() && (b->velocity.x != 0.0f || b->velocity.y != 0.0f))
+			UpdateRegions(b, true);
+	}
 
+	// The grid still holds the poses from before integration, without a
+	// motion margin unless speculative contacts are on. Rebuild it so the
+	// sweeps see bodies that moved into a bullet's path this step.
+	if (numBullets > 0)
+		grid.Build(bodies);
 
-		b->force.Set(0.0f, 0.0f);
-		b->torque = 0.0f;
+	for (int i = 0; i < numBullets; ++i)
+	{
+		Body* b = bullets[i];
+		SolveTOI(b, dt);
+
+		if (!regions.empty())
+			UpdateRegions(b, true);
+	}
+	stats.bullets = numBullets;
+	stats.frameBytes = frameAllocator.GetAllocation();
+
+	// Deliver buffered events outside the hot loops.
+	if (contactCallback != NULL)
+	{
+		for (int i = 0; i < (int)contactEvents.size(); ++i)
+			contactCallback(contactEvents[i], contactUserData);
 	}
+	contactEvents.clear();
 
+	if (regionCallback != NULL)
+	{
+		for (int i = 0; i < (int)regionEvents.size(); ++i)
+			regionCallback(regionEvents[i], regionUserData);
+	}
+	regionEvents.clear();
 }
@@ -16,32 +16,266 @@
 #include <map>
 #include "MathUtils.h"
 #include "Arbiter.h"
+#include "SpatialGrid.h"
+#include "Distance.h"
+#include "BlockAllocator.h"
+#include "FrameAllocator.h"
+#include "Pool.h"
 
 struct Body;
 struct Joint;
+struct ThreadPool;
+
+typedef Handle<Body> BodyHandle;
+typedef Handle<Joint> JointHandle;
+
+enum RegionEventType
+{
+	REGION_ENTER,
+	REGION_EXIT
+};
+
+struct RegionEvent
+{
+	int type;
+	int region;
+	Body* body;
+};
+
+// Axis-aligned trigger area tested against body centers.
+struct Region
+{
+	AABB bounds;
+	int count;	// bodies currently inside
+};
+
+typedef void (*RegionCallback)(const RegionEvent& event, void* userData);
+
+enum ContactEventType
+{
+	CONTACT_BEGIN,	// arbiter created
+	CONTACT_END		// arbiter destroyed
+};
+
+struct ContactEvent
+{
+	int type;
+	Body* body1;
+	Body* body2;
+};
+
+typedef void (*ContactCallback)(const ContactEvent& event, void* userData);
+
+struct RayCastHit
+{
+	Body* body;		// NULL for a miss
+	Vec2 point;
+	Vec2 normal;	// surface normal of body at point
+	real fraction;	// along p2 - p1, or along the cast translation
+};
+
+struct RayInput
+{
+	Vec2 p1, p2;
+};
+
+struct ShapeCastInput
+{
+	ShapeProxy shape;
+	real rotation;
+	Vec2 start;
+	Vec2 translation;
+};
+
+// Arbiter nodes come from the World's block allocator, so creating and
+// destroying contacts does not touch the general heap.
+typedef std::map<ArbiterKey, Arbiter, std::less<ArbiterKey>,
+	PoolAllocator<std::pair<const ArbiterKey, Arbiter> > > ArbiterMap;
+
+// Solver settings of one World, handed to the arbiters and joints each
+// step. Worlds in the same process, e.g. in a WorldBatch sweep, can use
+// different settings.
+struct SolverConfig
+{
+	SolverConfig() : accumulateImpulses(true), warmStarting(true), positionCorrection(true),
+		speculativeContacts(false), biasFactor(0.2f), allowedPenetration(0.01f),
+		adaptiveIterations(false), minIterations(2), maxIterations(30),
+		velocityTolerance(0.0001f), penetrationTolerance(0.005f) {}
+
+	bool accumulateImpulses;
+	bool warmStarting;
+	bool positionCorrection;
+
+	// Generate contacts for pairs that can touch within the next step, not
+	// only overlapping ones; a cheap alternative to bullets and SolveTOI.
+	bool speculativeContacts;
+
+	real biasFactor;			// fraction of contact penetration removed per step
+	real allowedPenetration;	// slop left uncorrected to keep contacts alive
+
+	// Solve each island of touching or jointed bodies with its own
+	// iteration count instead of World::iterations. After the solve, an
+	// island whose velocity error (estimated distance to the converged
+	// velocities) or penetration beyond allowedPenetration exceeds the
+	// tolerances gets more iterations next step; one well inside them
+	// gets fewer, down to minIterations.
+	bool adaptiveIterations;
+	int minIterations, maxIterations;
+	real velocityTolerance;
+	real penetrationTolerance;
+};
+
+// Per-step counters, reset at the start of BroadPhase.
+struct WorldStats
+{
+	WorldStats() : candidatePairs(0), filteredPairs(0), narrowPhasePairs(0),
+		bullets(0), toiPairs(0), toiHits(0), frameBytes(0),
+		islands(0), minIterations(0), maxIterations(0), constraintIterations(0) {}
+
+	int candidatePairs;		// AABB-overlapping pairs from the grid
+	int filteredPairs;		// rejected by ShouldCollide
+	int narrowPhasePairs;	// pairs that reached Collide
+	int bullets;			// bodies swept by SolveTOI
+	int toiPairs;			// time of impact evaluations
+	int toiHits;			// sub-steps ended by an impact
+	int frameBytes;			// frame allocator usage
+
+	// Solver work. Islands and the range of counts they used are only
+	// filled in adaptive mode.
+	int islands;				// islands with at least one constraint
+	int minIterations;
+	int maxIterations;
+	int constraintIterations;	// sum of iterations x constraints
+};
 
 struct World
 {
-	World(Vec2 gravity, int iterations) : gravity(gravity), iterations(iterations) {}
+	enum {MAX_REGIONS = 32};
+
+	World(Vec2 gravity, int iterations);
+	~World();
 
+	// Bodies and joints owned by the World, copied from def into pooled
+	// storage. Pointers from Get stay valid until the object is destroyed;
+	// handles of destroyed objects make Get return NULL. Destroying a body
+	// also destroys its joints and drops its contacts without raising
+	// contact events. Do not create or destroy from inside a callback.
+	BodyHandle CreateBody(const Body& def);
+	void DestroyBody(BodyHandle handle);
+	Body* GetBody(BodyHandle handle) const;
+	JointHandle CreateJoint(const Joint& def);
+	void DestroyJoint(JointHandle handle);
+	Joint* GetJoint(JointHandle handle) const;
 
+	// Bodies and joints kept by the caller, who must keep them alive until
+	// they are removed or the World is cleared. Remove also works on
+	// pooled objects but leaves their slot allocated. Removing a body only
+	// visits its own arbiters and joints, through Body::contactList and
+	// Body::jointList, and keeps the warm-start state of every other contact.
 	void Add(Body* body);
 	void Add(Joint* joint);
+	void Remove(Body* body);
+	void Remove(Joint* joint);
+
+	// True when a touching, non-sensor contact pushes the body along up,
+	// within Dot(normal, up) >= minDot; e.g. a block resting on the ground
+	// or on another block. Walks the body's contact list only.
+	bool IsSupported(const Body* body, const Vec2& up = Vec2(0.0f, 1.0f), real minDot = 0.5f) const;
+
+	// Unregisters every body and joint and destroys the pooled ones.
 	void Clear();
 
-	void Step(float dt,Body* selected);
+	void Step(real dt);
+
+	// Snapshot of bodies, joint impulses and arbiter contact caches.
+	// RestoreState expects the same bodies and joints to be registered.
+	void SaveState(std::vector<unsigned char>& state) const;
+	bool RestoreState(const std::vector<unsigned char>& state);
+
+	// FNV-1a hash of body positions and velocities, used to detect divergence.
+	unsigned int StateHash() const;
+
+	void BroadPhase(real dt);
+
+	// Rebuilds the broad-phase grid. Step does this every frame; call it
+	// after moving bodies by hand if queries must see the new positions.
+	void UpdateProxies();
+
+	// Lowest-id body whose shape contains the point, or NULL. Sees the
+	// proxies from the last Step or UpdateProxies, minus removed bodies.
+	Body* QueryPoint(const Vec2& point) const;
+
+	// Segment and swept-shape queries against bodies whose categoryBits
+	// match maskBits. The single-hit versions return the closest hit; the
+	// All versions return every body hit, sorted by fraction. Like
+	// QueryPoint they see the proxies from the last UpdateProxies.
+	bool RayCast(const Vec2& p1, const Vec2& p2, RayCastHit& hit, unsigned short maskBits = 0xFFFF) const;
+	void RayCastAll(const Vec2& p1, const Vec2& p2, std::vector<RayCastHit>& hits, unsigned short maskBits = 0xFFFF) const;
+	bool ShapeCast(const ShapeCastInput& input, RayCastHit& hit, unsigned short maskBits = 0xFFFF) const;
+	void ShapeCastAll(const ShapeCastInput& input, std::vector<RayCastHit>& hits, unsigned short maskBits = 0xFFFF) const;
+
+	// Closest hit for each input, spread over the pool. Misses leave
+	// hits[i].body NULL.
+	void RayCastBatch(const RayInput* rays, int count, RayCastHit* hits, ThreadPool& pool, unsigned short maskBits = 0xFFFF) const;
+	void ShapeCastBatch(const ShapeCastInput* inputs, int count, RayCastHit* hits, ThreadPool& pool, unsigned short maskBits = 0xFFFF) const;
+
+	// Regions are re-tested only for bodies that moved during Step. Events
+	// are buffered and delivered once at the end of Step; the callback must
+	// not add or remove bodies. Returns -1 when MAX_REGIONS is reached.
+	int AddRegion(const AABB& bounds);
+	void ClearRegions();
+	int GetRegionCount(int region) const { return regions[region].count; }
+	void SetRegionCallback(RegionCallback callback, void* userData);
+
+	// Recomputes region membership without raising events, e.g. after
+	// bodies were teleported or a snapshot was restored.
+	void RefreshRegions();
+
+	void UpdateRegions(Body* body, bool report);
+
+	// Moves a bullet through dt in up to k_maxSubSteps sub-steps. Each
+	// sub-step stops at the first impact against the other bodies' new
+	// poses and removes the closing velocity before continuing. Candidates
+	// come from the grid, which Step rebuilds after integrating the other
+	// bodies. Bullets are not swept against each other.
+	void SolveTOI(Body* bullet, real dt);
+
+	// Adaptive-mode solver. Splits the contacts and joints into islands
+	// in frame memory and solves each with the count stored in its
+	// bodies' solverIterations, then stores the adjusted count.
+	void SolveIslands(Arbiter** contacts, int numContacts, real inv_dt);
+
+	// Begin/end events for arbiters created or destroyed by BroadPhase,
+	// including sensor overlaps. Delivered at the end of Step like region
+	// events; Clear and RestoreState do not raise them.
+	void SetContactCallback(ContactCallback callback, void* userData);
+	void AddContactEvent(int type, Body* body1, Body* body2);
 
-	void BroadPhase();
 
+	// Declared first so they outlive the containers using them.
+	BlockAllocator blockAllocator;
+	FrameAllocator frameAllocator;		// reset at the start of Step
+	Pool<Body> bodyPool;
+	Pool<Joint> jointPool;
 
 	std::vector<Body*> bodies;
 	std::vector<Joint*> joints;
-	std::map<ArbiterKey, Arbiter> arbiters;
+	ArbiterMap arbiters;
+	SpatialGrid grid;
+	std::vector<GridPair> pairs;
+	std::vector<int> toiCandidates;
+	WorldStats stats;
+	std::vector<Region> regions;
+	std::vector<RegionEvent> regionEvents;
+	RegionCallback regionCallback;
+	void* regionUserData;
+	std::vector<ContactEvent> contactEvents;
+	ContactCallback contactCallback;
+	void* contactUserData;
+	int nextBodyId;
 	Vec2 gravity;
 	int iterations;
-	static bool accumulateImpulses;
-	static bool warmStarting;
-	static bool positionCorrection;
+	SolverConfig config;
 };
 
 #endif
@@ -0,0 +1,138 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+#include "WorldBatch.h"
+
+#include <map>
+#include <chrono>
+
+void SceneTemplate::Set(const World& world)
+{
+	gravity = world.gravity;
+	iterations = world.iterations;
+	config = world.config;
+
+	bodies.resize(world.bodies.size());
+	std::map<const Body*, int> indices;
+	for (int i = 0; i < (int)world.bodies.size(); ++i)
+	{
+		bodies[i] = *world.bodies[i];
+		indices[world.bodies[i]] = i;
+	}
+
+	joints.resize(world.joints.size());
+	for (int i = 0; i < (int)world.joints.size(); ++i)
+	{
+		joints[i].joint = *world.joints[i];
+		joints[i].body1 = indices[world.joints[i]->body1];
+		joints[i].body2 = indices[world.joints[i]->body2];
+	}
+}
+
+BatchWorld::BatchWorld(const SceneTemplate* scene) :
+	world(scene->gravity, scene->iterations),
+	bodies(scene->bodies),
+	scene(scene),
+	fallStep(-1),
+	steps(0)
+{
+	world.config = scene->config;
+
+	// Storage is sized up front so the world can hold raw pointers.
+	for (int i = 0; i < (int)bodies.size(); ++i)
+		world.Add(&bodies[i]);
+
+	joints.resize(scene->joints.size());
+	for (int i = 0; i < (int)joints.size(); ++i)
+	{
+		const SceneTemplate::JointDef& def = scene->joints[i];
+		joints[i] = def.joint;
+		joints[i].body1 = &bodies[def.body1];
+		joints[i].body2 = &bodies[def.body2];
+		world.Add(&joints[i]);
+	}
+}
+
+WorldBatch::WorldBatch(int numThreads) :
+	fallLimit(-8.0f),
+	stopOnFall(true),
+	worldStepsPerSecond(0.0),
+	pool(numThreads),
+	dt(0.0f)
+{
+}
+
+WorldBatch::~WorldBatch()
+{
+	Clear();
+}
+
+int WorldBatch::Add(const SceneTemplate* scene)
+{
+	worlds.push_back(new BatchWorld(scene));
+	return (int)worlds.size() - 1;
+}
+
+void WorldBatch::Clear()
+{
+	for (int i = 0; i < (int)worlds.size(); ++i)
+		delete worlds[i];
+	worlds.clear();
+}
+
+void WorldBatch::StepTask(void* context, int index)
+{
+	WorldBatch* batch = (WorldBatch*)context;
+	BatchWorld* w = batch->worlds[index];
+
+	if (batch->stopOnFall && w->fallStep >= 0)
+		return;
+
+	w->world.Step(batch->dt);
+
+	if (w->fallStep < 0)
+	{
+		for (int i = 0; i < (int)w->bodies.size(); ++i)
+		{
+			if (w->bodies[i].position.y < batch->fallLimit)
+			{
+				w->fallStep = w->steps;
+				break;
+			}
+		}
+	}
+
+	++w->steps;
+}
+
+void WorldBatch::Step(real timeStep, int numSteps)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	dt = timeStep;
+
+	int before = 0;
+	for (int i = 0; i < (int)worlds.size(); ++i)
+		before += worlds[i]->steps;
+
+	Clock::time_point start = Clock::now();
+
+	for (int i = 0; i < numSteps; ++i)
+		pool.ParallelFor((int)worlds.size(), StepTask, this);
+
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	int after = 0;
+	for (int i = 0; i < (int)worlds.size(); ++i)
+		after += worlds[i]->steps;
+
+	worldStepsPerSecond = seconds > 0.0 ? (after - before) / seconds : 0.0;
+}
@@ -0,0 +1,95 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* Permission to use, copy, modify, distribute and sell this software
+* and its documentation for any purpose is hereby granted without fee,
+* provided that the above copyright notice appear in all copies.
+* Erin Catto makes no representations about the suitability 
+* of this software for any purpose.  
+* It is provided "as is" without express or implied warranty.
+*/
+
+#ifndef WORLDBATCH_H
+#define WORLDBATCH_H
+
+#include <vector>
+#include "MathUtils.h"
+#include "Body.h"
+#include "Joint.h"
+#include "World.h"
+#include "ThreadPool.h"
+
+// Read-only scene shared by every world instantiated from it.
+struct SceneTemplate
+{
+	struct JointDef
+	{
+		int body1, body2;	// indices into bodies
+		Joint joint;
+	};
+
+	// Copies the bodies and joints registered with the world.
+	void Set(const World& world);
+
+	std::vector<Body> bodies;
+	std::vector<JointDef> joints;
+	Vec2 gravity;
+	int iterations;
+	SolverConfig config;
+};
+
+struct BatchWorld
+{
+	BatchWorld(const SceneTemplate* scene);
+
+	World world;
+	std::vector<Body> bodies;
+	std::vector<Joint> joints;
+	const SceneTemplate* scene;
+
+	// Outcome
+	int fallStep;	// first step with a body below WorldBatch::fallLimit, -1 if none
+	int steps;
+};
+
+// Steps many independent worlds in lockstep on a work-stealing thread pool.
+struct WorldBatch
+{
+	explicit WorldBatch(int numThreads = 0);
+	~WorldBatch();
+
+	// Instantiates a world from the template. Bodies can be edited through
+	// GetBodies before the first Step; it returns NULL for an empty scene.
+	int Add(const SceneTemplate* scene);
+	void Clear();
+
+	Body* GetBodies(int index)
+	{
+		std::vector<Body>& bodies = worlds[index]->bodies;
+		return bodies.empty() ? NULL : &bodies[0];
+	}
+
+	// Solver settings of one world, copied from the template. Can differ
+	// between worlds, e.g. to sweep for the cheapest stable settings.
+	SolverConfig& GetConfig(int index) { return worlds[index]->world.config; }
+	const BatchWorld& GetWorld(int index) const { return *worlds[index]; }
+	int GetWorldCount() const { return (int)worlds.size(); }
+
+	// Advances every unresolved world by numSteps steps of dt.
+	void Step(real dt, int numSteps);
+
+	real fallLimit;		// CheckGameOver threshold
+	bool stopOnFall;		// stop stepping a world once it has an outcome
+
+	// Throughput of the last Step call.
+	double worldStepsPerSecond;
+
+private:
+	static void StepTask(void* context, int index);
+
+	ThreadPool pool;
+	std::vector<BatchWorld*> worlds;
+	real dt;
+};
+
+#endif
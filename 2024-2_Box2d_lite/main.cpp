@@ -17,24 +17,25 @@
 #include "World.h"
 #include "Body.h"
 #include "Joint.h"
+#include "SceneFile.h"
+#include "Replay.h"
+#include "Renderer.h"
 #include <iostream>
+#include <chrono>
 
 namespace
 {
-	Body bodies[200];
-	Joint joints[100];
-
 	Body *bomb = NULL;
 	const float timeStep = 1.0f / 60.0f; // 1/60초로 고정
 	const float oneFrame = timeStep * 1000;
 	int iterations = 10;
 	Vec2 gravity(0.0f, 0.0f);
 
-	int numBodies = 0;
-	int numJoints = 0;
 	int demoIndex = 0;
 
 	World world(gravity, iterations);
+	std::vector<unsigned char> roundState; // InitDemo 직후 스냅샷
+	std::vector<unsigned char> undoState;  // 마지막 드래그 이전 스냅샷
 
 	Body *selectedBody = nullptr; 
 	float mouseX, mouseY;		 
@@ -85,6 +86,23 @@ namespace
 	const float WORLD_Y_OFFSET = 3;	// y 오프셋을 상수로 정의
 	const float WORLD_ASPECT = WORLD_WIDTH / WORLD_HEIGHT; 
 	const int MaxRound = 5;
+
+	// Round%d.bscn 파일이 있으면 절차적 생성 대신 매핑해서 사용
+	SceneMapping roundScenes[MaxRound];
+
+	// --record 로 입력과 스텝별 상태 해시를 기록
+	Replay replay;
+	const char* replayPath = NULL;
+
+	// (B) 키로 일괄 렌더러와 기존 glBegin/glEnd 경로를 비교
+	Renderer renderer;
+	bool batchedDraw = true;
+	float drawTime = 0.0f; // ms, 이동 평균
+
+	// 월드 영역 트리거: 플레이 영역 이탈, 배치 영역 안의 물체 수
+	int playRegion = -1;
+	int stagingRegion = -1;
+	bool fellOut = false;
 }
 
 
@@ -234,6 +252,7 @@ void Reshape(int width, int height) //조정
 		worldHeight = worldWidth / screenAspect;
 	}
 	glViewport(0, 0, width, height);
+	renderer.SetPixelsPerUnit(width / worldWidth);
 	glMatrixMode(GL_PROJECTION);
 	glLoadIdentity();
 	glOrtho(-worldWidth / 2, worldWidth / 2, -worldHeight / 2, worldHeight / 2, -1.0f, 1.0f);
@@ -348,7 +367,7 @@ static void DrawBody(Body *body)
 	Mat22 R(body->rotation);
 	Vec2 x = body->position;
 	Vec2 h = 0.5f * body->width;
-	float r = body->radius;
+	float r = (float)body->radius;
 	Vec2 v1;
 	Vec2 v2;
 	Vec2 v3;
@@ -366,18 +385,18 @@ static void DrawBody(Body *body)
 		v4 = x + R * Vec2(-h.x, h.y);
 
 		glBegin(GL_QUADS);
-		glVertex2f(v1.x, v1.y);
-		glVertex2f(v2.x, v2.y);
-		glVertex2f(v3.x, v3.y);
-		glVertex2f(v4.x, v4.y);
+		glVertex2f((float)v1.x, (float)v1.y);
+		glVertex2f((float)v2.x, (float)v2.y);
+		glVertex2f((float)v3.x, (float)v3.y);
+		glVertex2f((float)v4.x, (float)v4.y);
 		glEnd();
 
 		glColor3f(0,0,0);
 		glBegin(GL_LINE_STRIP);
-		glVertex2f(v1.x, v1.y);
-		glVertex2f(v2.x, v2.y);
-		glVertex2f(v3.x, v3.y);
-		glVertex2f(v4.x, v4.y);
+		glVertex2f((float)v1.x, (float)v1.y);
+		glVertex2f((float)v2.x, (float)v2.y);
+		glVertex2f((float)v3.x, (float)v3.y);
+		glVertex2f((float)v4.x, (float)v4.y);
 		glEnd();
 		break;
 
@@ -390,8 +409,8 @@ static void DrawBody(Body *body)
 		for (float i = 0; i < 1; i += 0.02)
 		{
 			float angle = 2.0f * M_PI * i;	  //  theta
-			float v1 = x.x + r * cosf(angle); // x 
-			float v2 = x.y + r * sinf(angle); // y 
+			float v1 = (float)x.x + r * cosf(angle); // x 
+			float v2 = (float)x.y + r * sinf(angle); // y 
 			glVertex2f(v1, v2);
 		}
 		glEnd();
@@ -401,8 +420,8 @@ static void DrawBody(Body *body)
 		for (float i = 0; i < 1; i += 0.02)
 		{
 			float angle = 2.0f * M_PI * i;	  //  theta
-			float v1 = x.x + r * cosf(angle); // x 
-			float v2 = x.y + r * sinf(angle); // y 
+			float v1 = (float)x.x + r * cosf(angle); // x 
+			float v2 = (float)x.y + r * sinf(angle); // y 
 			glVertex2f(v1, v2);
 		}	glEnd();
 		break;
@@ -416,20 +435,33 @@ static void DrawBody(Body *body)
 		v2 = x + R * Vec2(h.x, -h.y);
 		v3 = x + R * Vec2(0, h.y);
 		glBegin(GL_POLYGON);
-		glVertex2f(v1.x, v1.y);
-		glVertex2f(v2.x, v2.y);
-		glVertex2f(v3.x, v3.y);
+		glVertex2f((float)v1.x, (float)v1.y);
+		glVertex2f((float)v2.x, (float)v2.y);
+		glVertex2f((float)v3.x, (float)v3.y);
 		glEnd();
 
 		glColor3f(0, 0, 0);
 		glBegin(GL_LINE_STRIP);
-		glVertex2f(v1.x, v1.y);
-		glVertex2f(v2.x, v2.y);
-		glVertex2f(v3.x, v3.y);
+		glVertex2f((float)v1.x, (float)v1.y);
+		glVertex2f((float)v2.x, (float)v2.y);
+		glVertex2f((float)v3.x, (float)v3.y);
 		glEnd();
 		break;
 	}
 }
+void DrawContacts()
+{
+	glPointSize(4.0f);
+	glColor3f(1.0f, 0.0f, 0.0f);
+	glBegin(GL_POINTS);
+	for (ArbiterMap::const_iterator arb = world.arbiters.begin(); arb != world.arbiters.end(); ++arb)
+	{
+		for (int i = 0; i < arb->second.numContacts; ++i)
+			glVertex2f((float)arb->second.contacts[i].position.x, (float)arb->second.contacts[i].position.y);
+	}
+	glEnd();
+	glPointSize(1.0f);
+}
 void DrawJoint(Joint *joint)
 {
 	Body *b1 = joint->body1;
@@ -446,10 +478,10 @@ void DrawJoint(Joint *joint)
 
 	glColor3f(0.5f, 0.5f, 0.8f);
 	glBegin(GL_LINES);
-	glVertex2f(x1.x, x1.y);
-	glVertex2f(p1.x, p1.y);
-	glVertex2f(x2.x, x2.y);
-	glVertex2f(p2.x, p2.y);
+	glVertex2f((float)x1.x, (float)x1.y);
+	glVertex2f((float)p1.x, (float)p1.y);
+	glVertex2f((float)x2.x, (float)x2.y);
+	glVertex2f((float)p2.x, (float)p2.y);
 	glEnd();
 }
 
@@ -472,58 +504,49 @@ void DrawJoint(Joint *joint)
 #pragma endregion
 
 #pragma region GameScenes
+// 씬 정의용 Body를 월드 풀에 복사하고 다음 정의를 위해 초기화
+void AddBody(Body *def)
+{
+	world.CreateBody(*def);
+	*def = Body();
+}
+
 void Round1Scene(Body *b, Joint *j)
 {
 	b->BoxSet(Vec2(0.4f, 0.4f), FLT_MAX);
 	b->position.Set(0, 0 );
 	b->canDrag = false;
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->BoxSet(Vec2(5, 0.5f), 100);
 	b->position.Set(0.0f, 0.5);
 	b->canDrag = false;
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->BoxSet(Vec2(1, 1), 100);
 	b->position.Set(-5, 12);
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->BoxSet(Vec2(1, 1), 100);
 	b->position.Set(-2, 12);
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->BoxSet(Vec2(1, 1), 100);
 	b->position.Set(2, 12);
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->BoxSet(Vec2(1, 1), 100);
 	b->position.Set(5, 12);
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->CircleSet(Vec2(1, 1), 100);
 	b->position.Set(-7, 12);
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 
 	b->CircleSet(Vec2(1, 1), 100);
 	b->position.Set(-0, 12);
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 }
 void Round2Scene(Body* b, Joint* j)
@@ -531,28 +554,20 @@ void Round2Scene(Body* b, Joint* j)
 	b->BoxSet(Vec2(0.2, 0.2), FLT_MAX);
 	b->position.Set(2, 0);
 	b->canDrag = false;
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->BoxSet(Vec2(0.2, 0.2), FLT_MAX);
 	b->position.Set(-2, 0);
 	b->canDrag = false;
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->TriangleSet(Vec2(2, 2), 100);
 	b->position.Set(-2, 12);
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->TriangleSet(Vec2(2, 2), 100);
 	b->position.Set(1, 12);
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 
 
@@ -562,40 +577,28 @@ void Round3Scene(Body *b, Joint *j)
 	b->BoxSet(Vec2(0.2f, 0.2f), FLT_MAX);
 	b->position.Set(0, 0);
 	b->canDrag = false;
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->BoxSet(Vec2(5, 0.5f), 100);
 	b->position.Set(0.0f, 0.5);
 	b->canDrag = false;
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->BoxSet(Vec2(1, 5), 100);
 	b->position.Set(0.0f, 12);
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->BoxSet(Vec2(1, 5), 100);
 	b->position.Set(-4, 12);
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->CircleSet(Vec2(1, 1), 100);
 	b->position.Set(-2, 12);
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->CircleSet(Vec2(1, 1), 100);
 	b->position.Set(2, 12);
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 }
 void Round4Scene(Body *b, Joint *j)
@@ -603,66 +606,46 @@ void Round4Scene(Body *b, Joint *j)
 	b->BoxSet(Vec2(0.2f, 0.2f), FLT_MAX);
 	b->position.Set(-2, 0);
 	b->canDrag = false;
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->BoxSet(Vec2(3, 0.5f), 100);
 	b->position.Set(-2, 0.5);
 	b->canDrag = false;
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->BoxSet(Vec2(0.2f, 0.2f), FLT_MAX);
 	b->position.Set(2, 0);
 	b->canDrag = false;
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->BoxSet(Vec2(3, 0.5f), 100);
 	b->position.Set(2, 0.5);
 	b->canDrag = false;
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->BoxSet(Vec2(1, 1), 100);
 	b->position.Set(7, 12);
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->BoxSet(Vec2(1, 1), 100);
 	b->position.Set(5, 12);
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->BoxSet(Vec2(1, 1), 100);
 	b->position.Set(2, 12);
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->BoxSet(Vec2(1, 1), 100);
 	b->position.Set(0, 12);
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->CircleSet(Vec2(1, 1), 100);
 	b->position.Set(-2, 12);
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->CircleSet(Vec2(1, 1), 100);
 	b->position.Set(-5, 12);
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 
 
@@ -672,65 +655,45 @@ void Round5Scene(Body* b, Joint* j)
 	b->BoxSet(Vec2(0.2f, 0.2f), FLT_MAX);
 	b->position.Set(0, 0);
 	b->canDrag = false;
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->BoxSet(Vec2(10, 0.5f), 100);
 	b->position.Set(0.0f, 0.5);
 	b->canDrag = false;
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->BoxSet(Vec2(4, 0.5f), 100);
 	b->position.Set(2, 11);
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->BoxSet(Vec2(3, 0.5f), 100);
 	b->position.Set(3, 12);
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->BoxSet(Vec2(2, 0.5f), 100);
 	b->position.Set(4, 13);
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->BoxSet(Vec2(1, 0.5f), 100);
 	b->position.Set(-1, 12);
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->BoxSet(Vec2(1, 3), 100);
 	b->position.Set(-3, 12);
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->BoxSet(Vec2(1, 3), 100);
 	b->position.Set(-5, 12);
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->CircleSet(Vec2(1, 3), 100);
 	b->position.Set(-7, 12);
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 	b->CircleSet(Vec2(2, 2), 100);
 	b->position.Set(0, 2);
 	b->canDrag = false;
-	world.Add(b);
-	++b;
-	++numBodies;
+	AddBody(b);
 
 
 }
@@ -758,17 +721,26 @@ void (*demos[])(Body* b, Joint* j) = {
 
 void InitDemo(int index)
 {
+	replay.Record(REPLAY_SCENE, index);
+	// Clear가 바디를 해제하므로 선택도 놓는다
+	selectedBody = nullptr;
+	isDragging = false;
 	world.Clear();
-	numBodies = 0;
-	numJoints = 0;
+	fellOut = false;
 	bomb = NULL;
-	
-	for (int i = 0; i < 200; ++i)
+	demoIndex = index;
+	if (index < MaxRound && roundScenes[index].header)
 	{
-		bodies[i].canDrag = true; // 드래그 속성 초기화
+		BuildScene(roundScenes[index], world);
 	}
-	demoIndex = index;
-	demos[index](bodies, joints);
+	else
+	{
+		Body bodyDef;
+		Joint jointDef;
+		demos[index](&bodyDef, &jointDef);
+	}
+	world.SaveState(roundState);
+	undoState.clear();
 }
 
 void ChangeGravity() {
@@ -778,34 +750,48 @@ void ChangeGravity() {
 	else {
 		world.gravity.y = 0.0f;    // 중력 끄기
 	}
+	replay.Record(REPLAY_GRAVITY, 0, 0.0f, (float)world.gravity.y);
 }
 
 void CheckGameReady() {
-	isReady = true; 
-	for (int i = 0; i < numBodies; ++i) {
-		Body& b = bodies[i]; 
-
-		if (b.position.y < -2 || b.position.y > 10 || b.position.x < -12 || b.position.x > 12) {
-			isReady = false;
-			break; 
-		}
-	}
+	isReady = world.GetRegionCount(stagingRegion) == (int)world.bodies.size();
 }
 void CheckGameOver()
 {
-	for each (Body b in bodies)
+	if (fellOut)
 	{
-		if (b.position.y < -8)
-		{
-			gameState = GameOver;
-			InitDemo(GameOverScene);
-			ChangeGravity();
-			glutPostRedisplay();
-			break;
-		}
+		gameState = GameOver;
+		InitDemo(GameOverScene);
+		ChangeGravity();
+		glutPostRedisplay();
 	}
 }
 
+// Step 끝에서 한 번에 전달됨. 여기서 월드를 수정하지 않는다
+void OnRegionEvent(const RegionEvent& e, void* userData)
+{
+	if (e.region == playRegion && e.type == REGION_EXIT && gameState == Play)
+		fellOut = true;
+
+	if (e.region == stagingRegion && gameState == Stay)
+		CheckGameReady();
+}
+
+void InitRegions()
+{
+	AABB play;
+	play.lowerBound.Set(-FLT_MAX, -8.0f);
+	play.upperBound.Set(FLT_MAX, FLT_MAX);
+	playRegion = world.AddRegion(play);
+
+	AABB staging;
+	staging.lowerBound.Set(-12.0f, -2.0f);
+	staging.upperBound.Set(12.0f, 10.0f);
+	stagingRegion = world.AddRegion(staging);
+
+	world.SetRegionCallback(OnRegionEvent, NULL);
+}
+
 void NextRound() {
 	IsGravityOn = !IsGravityOn;
 	ChangeGravity();
@@ -817,9 +803,16 @@ void NextRound() {
 
 void RestartRound(int round) {
 	gameState = Stay;
+	selectedBody = nullptr;
+	isDragging = false;
 	IsGravityOn = false;
 	ChangeGravity();
-	InitDemo(round);
+	// 같은 라운드면 재생성 없이 스냅샷 복원
+	if (demoIndex != round || !world.RestoreState(roundState))
+		InitDemo(round);
+	else
+		replay.Record(REPLAY_RESTORE, round);
+	undoState.clear();
 	Reshape(glutGet(GLUT_SCREEN_WIDTH), glutGet(GLUT_SCREEN_HEIGHT));
 	glutPostRedisplay(); 
 	isReady = false;
@@ -887,6 +880,12 @@ void UserInterface() {
 
 		sprintf(buffer, isReady ? "Ready" : "Stay");
 		DrawText(5, 110, buffer);
+
+		sprintf(buffer, "(B)atched Draw %s %.3f ms", batchedDraw ? "ON" : "OFF", drawTime);
+		DrawText(5, 140, buffer);
+
+		sprintf(buffer, "Pairs %d Filtered %d Narrow %d", world.stats.candidatePairs, world.stats.filteredPairs, world.stats.narrowPhasePairs);
+		DrawText(5, 170, buffer);
 		break;
 	case GameOver:
 		sprintf(buffer, "(R)estart Pre Round ");
@@ -922,7 +921,9 @@ void SimulationLoop()
 	glLoadIdentity();
 	glTranslatef(0.0f, -WORLD_Y_Half + WORLD_Y_OFFSET, 0);
 
-	world.Step(timeStep, selectedBody);
+	world.Step(timeStep);
+	replay.RecordStep(world.StateHash());
+	DrawContacts();
 
 	switch (gameState) {
 	case Play:
@@ -942,11 +943,29 @@ void SimulationLoop()
 			break;
 	}
 	
-	for (int i = 0; i < numBodies; ++i)
-		DrawBody(bodies + i);
+	std::chrono::high_resolution_clock::time_point drawStart = std::chrono::high_resolution_clock::now();
+
+	if (batchedDraw)
+	{
+		renderer.Begin();
+		for (int i = 0; i < (int)world.bodies.size(); ++i)
+			renderer.AddBody(world.bodies[i]);
+
+		for (int i = 0; i < (int)world.joints.size(); ++i)
+			renderer.AddJoint(world.joints[i]);
+		renderer.Flush();
+	}
+	else
+	{
+		for (int i = 0; i < (int)world.bodies.size(); ++i)
+			DrawBody(world.bodies[i]);
+
+		for (int i = 0; i < (int)world.joints.size(); ++i)
+			DrawJoint(world.joints[i]);
+	}
 
-	for (int i = 0; i < numJoints; ++i)
-		DrawJoint(joints + i);
+	float elapsed = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - drawStart).count();
+	drawTime = 0.95f * drawTime + 0.05f * elapsed;
 
 	glutSwapBuffers();
 }
@@ -960,6 +979,8 @@ void Keyboard(unsigned char key, int x, int y)
 	switch (key)
 	{
 	case 27:
+		if (replay.recording && !replay.Save(replayPath))
+			std::cout << "failed to write " << replayPath << std::endl;
 		exit(0);
 		break;
 	/*case '8':					//라운드 확인용
@@ -988,7 +1009,18 @@ void Keyboard(unsigned char key, int x, int y)
 	case 'f':
 		ToggleFullScreen();
 		break;
+	case 'b':
+		batchedDraw = !batchedDraw;
+		break;
+	case 'z':
+		if (isDragging || gameState != Stay || undoState.empty()) return;
+		world.RestoreState(undoState);
+		undoState.clear();
+		replay.Record(REPLAY_UNDO);
+		CheckGameReady();
+		break;
 	case 'r':
+		if (isDragging) return;
 		deathCount++;
 		RestartRound(currentRound);
 		break;
@@ -1027,30 +1059,27 @@ void MouseInput(int button, int state, int x, int y)
 	if (button == GLUT_LEFT_BUTTON && state == GLUT_DOWN)
 	{
 
-		for (int i = 0; i < numBodies; ++i)
+		//마우스 감지 (회전과 모양을 반영한 월드 쿼리)
+		Body *body = world.QueryPoint(Vec2(mouseX, mouseY));
+		if (body)
 		{
-			Body *body = &bodies[i];
-			Vec2 halfSize = body->width * 0.5f;
-
-			//마우스 감지
-			if (mouseX >= body->position.x - halfSize.x &&
-				mouseX <= body->position.x + halfSize.x &&
-				mouseY >= body->position.y - halfSize.y &&
-				mouseY <= body->position.y + halfSize.y)
+			selectedBody = body;
+			replay.Record(REPLAY_SELECT, body->index);
+			if (selectedBody->canDrag)  // 고정 물체 제외
 			{
-
-				selectedBody = body;
-				if(selectedBody->canDrag == false) break; // 고정 물체 제외
-				selectedBody->angularVelocity = 0;
-				selectedBody->velocity = Vec2(0, 0);
+				world.SaveState(undoState);
+				selectedBody->SetKinematic(true);	// 드래그 중에는 목표 위치를 따라가며 다른 물체를 민다
 				isDragging = true;
-				break;
 			}
 		}
 	}
 
 	if (button == GLUT_LEFT_BUTTON && state == GLUT_UP)
 	{
+		if (selectedBody)
+			replay.Record(REPLAY_SELECT, -1);
+		if (isDragging && selectedBody)
+			selectedBody->SetKinematic(false);
 		isDragging = false;
 		selectedBody = nullptr;
 	}
@@ -1064,14 +1093,131 @@ void MouseDrag(int x, int y)
 		mouseX = ScreenToWorldX(x);
 		mouseY = ScreenToWorldY(y);
 
-		selectedBody->position.Set(mouseX, mouseY);
-		CheckGameReady();
+		selectedBody->SetTarget(Vec2(mouseX, mouseY), selectedBody->rotation);
+		replay.Record(REPLAY_DRAG, 0, mouseX, mouseY);
 	}
 }
 #pragma endregion
 
+void SceneFileName(char* buffer, int round)
+{
+	sprintf(buffer, "Round%d.bscn", round + 1);
+}
+
+// 절차적 라운드를 바이너리 씬 파일로 변환
+void ExportScenes()
+{
+	char path[64];
+	for (int i = 0; i < MaxRound; ++i)
+	{
+		InitDemo(i);
+		SceneFileName(path, i);
+		if (!SaveScene(path, world))
+			std::cout << "failed to write " << path << std::endl;
+	}
+}
+
+void LoadScenes()
+{
+	char path[64];
+	for (int i = 0; i < MaxRound; ++i)
+	{
+		SceneFileName(path, i);
+		MapScene(path, roundScenes[i]);
+	}
+}
+
+// 기록된 입력을 창 없이 재시뮬레이션하고 첫 불일치 스텝을 보고
+int RunReplay(const char* path)
+{
+	Replay playback;
+	if (!playback.Load(path))
+	{
+		std::cout << "failed to read " << path << std::endl;
+		return 1;
+	}
+
+	int next = 0;
+	int numEvents = (int)playback.events.size();
+	int numSteps = (int)playback.hashes.size();
+	for (int step = 0; step < numSteps; ++step)
+	{
+		for (; next < numEvents && playback.events[next].step == step; ++next)
+		{
+			const ReplayEvent& e = playback.events[next];
+			switch (e.type)
+			{
+			case REPLAY_SCENE:
+				InitDemo(e.value);
+				break;
+			case REPLAY_RESTORE:
+				selectedBody = nullptr;
+				isDragging = false;
+				world.RestoreState(roundState);
+				undoState.clear();
+				break;
+			case REPLAY_GRAVITY:
+				world.gravity.y = e.y;
+				break;
+			case REPLAY_SELECT:
+				if (isDragging && selectedBody)
+					selectedBody->SetKinematic(false);
+				isDragging = false;
+				selectedBody = e.value >= 0 && e.value < (int)world.bodies.size() ? world.bodies[e.value] : nullptr;
+				if (selectedBody && selectedBody->canDrag)
+				{
+					world.SaveState(undoState);
+					selectedBody->SetKinematic(true);
+					isDragging = true;
+				}
+				break;
+			case REPLAY_DRAG:
+				if (isDragging && selectedBody)
+					selectedBody->SetTarget(Vec2(e.x, e.y), selectedBody->rotation);
+				break;
+			case REPLAY_UNDO:
+				world.RestoreState(undoState);
+				undoState.clear();
+				break;
+			}
+		}
+
+		world.Step(timeStep);
+
+		if (world.StateHash() != playback.hashes[step])
+		{
+			std::cout << "replay diverged at step " << step << std::endl;
+			return 2;
+		}
+	}
+
+	std::cout << "replay matched " << numSteps << " steps" << std::endl;
+	return 0;
+}
+
 int main(int argc, char** argv)
 {
+	InitRegions();
+
+	if (argc > 1 && strcmp(argv[1], "--export-scenes") == 0)
+	{
+		ExportScenes();
+		return 0;
+	}
+
+	if (argc > 2 && strcmp(argv[1], "--replay") == 0)
+	{
+		LoadScenes();
+		return RunReplay(argv[2]);
+	}
+
+	if (argc > 2 && strcmp(argv[1], "--record") == 0)
+	{
+		replayPath = argv[2];
+		replay.recording = true;
+	}
+
+	LoadScenes();
 	InitDemo(Round1);
 	IsGravityOn = false;
 	glutInit(&argc, argv);